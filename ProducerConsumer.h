@@ -1,274 +1,2921 @@
-#pragma once
-
-#include <thread>
-#include <atomic>
-#include <mutex>
-#include <condition_variable>
-#include <ctime>
-#include <memory>
-#include <queue>
-#include <functional>
-#include <chrono>
-#include <cassert>
-
-static const int EMPTY = -1;
-static const int EXIT = -2;
-
-class IQueue {
-public:
-	virtual bool produce(int value) = 0;
-	virtual bool consume(int& value) = 0;
-	virtual bool empty() { return true; }
-	virtual bool full() { return false; }
-	virtual int size() { return 0; }
-	virtual ~IQueue() = default;
-};
-
-class Queue 
-	: public IQueue {
-protected:
-	std::queue<int> queue;
-public:
-	virtual bool produce(int value) override {
-		queue.push(value);
-		return true;
-	}
-	virtual bool consume(int& value) override {
-		value = queue.back();
-		queue.pop();
-		return true;
-	}
-	virtual bool empty() override { return queue.empty(); }
-	virtual int size() override { return static_cast<int>(queue.size()); }
-	virtual ~Queue() override = default;
-};
-
-// pattern: decorator
-class QueueDecorator
-	: public IQueue {
-private:
-	IQueue* pQueue;
-public:
-	QueueDecorator(IQueue* pQueue)
-		: pQueue(pQueue) {}
-	virtual bool produce(int value) override {
-		return pQueue->produce(value);
-	}
-	virtual bool consume(int& value) override {
-		return pQueue->consume(value);
-	}
-	virtual bool empty() override { return pQueue->empty(); }
-	virtual bool full() override { return pQueue->full(); }
-	virtual int size() override { return pQueue->size(); }
-	virtual ~QueueDecorator() override = default;
-};
-
-class SafeQueue
-	: public QueueDecorator {
-public:
-	using QueueDecorator::QueueDecorator;
-	virtual bool consume(int& value) override {
-		if (QueueDecorator::empty()) return false;
-		return QueueDecorator::consume(value);
-	}
-	virtual ~SafeQueue() override = default;
-};
-
-class SizeLimitedQueue
-	: public QueueDecorator {
-private:
-	int maxSize;
-public:
-	SizeLimitedQueue(IQueue* pQueue, int maxSize)
-		: QueueDecorator(pQueue), maxSize(maxSize) {}
-	virtual bool produce(int value) override {
-		if (full()) return false;
-		return QueueDecorator::produce(value);
-	}
-	virtual bool full() override {
-		return QueueDecorator::size() >= maxSize || QueueDecorator::full();
-	}
-	virtual ~SizeLimitedQueue() override = default;
-};
-
-
-// pattern: strategy (produce() and consume())
-class ProduceConsumeStrategy {
-protected:
-	IQueue* pQueue;
-	mutable std::mutex queueLock;
-	std::atomic<bool> stop;
-public:
-	ProduceConsumeStrategy(IQueue* pQueue)
-		: pQueue(pQueue), stop(false) {}
-	virtual void produce(int value) const = 0;
-	virtual int consume() const = 0;
-	void setStop(bool stop) { this->stop = stop; }
-	virtual ~ProduceConsumeStrategy() = default;
-};
-
-class BruteForceProduceConsume
-	: public ProduceConsumeStrategy { 
-public:
-	using ProduceConsumeStrategy::ProduceConsumeStrategy;
-	virtual void produce(int value) const override {
-		bool produced = false;
-		while (!stop && !produced) {
-			std::unique_lock<std::mutex> locker(queueLock);
-			produced = pQueue->produce(value);
-		}
-	}
-	virtual int consume() const override {
-		int consumedValue = 0;
-		bool consumed;
-		while (!stop && !consumed) {
-			std::unique_lock<std::mutex> locker(queueLock);
-			consumed = pQueue->consume(consumedValue);
-		}
-		return consumedValue;
-	}
-	virtual ~BruteForceProduceConsume() override = default;
-};
-
-class SleepProduceConsume
-	: public ProduceConsumeStrategy {
-public:
-	typedef std::function<void()> SleepStrategy;
-protected:
-	SleepStrategy sleep = std::this_thread::yield;
-public:
-	using ProduceConsumeStrategy::ProduceConsumeStrategy;
-	void setSleepStrategy(SleepStrategy strategy) {
-		sleep = strategy;
-	}
-	virtual void produce(int value) const override {
-		while (!stop) {
-			std::unique_lock<std::mutex> locker(queueLock);
-			if (pQueue->produce(value)) return;
-			else sleep();
-		}
-	}
-	virtual int consume() const override {
-		int consumedValue = 0;
-		while (!stop) {
-			std::unique_lock<std::mutex> locker(queueLock);
-			if (pQueue->consume(consumedValue)) return consumedValue;
-			else sleep();
-		}
-	}
-	virtual ~SleepProduceConsume() override = default;
-};
-
-class WaitProduceConsume
-	: public ProduceConsumeStrategy {
-protected:
-	mutable std::condition_variable onConsumeFromFull;
-	mutable std::condition_variable onProduceToEmpty;
-public:
-	using ProduceConsumeStrategy::ProduceConsumeStrategy;
-	virtual void produce(int value) const override {
-		bool wasEmpty;
-		{
-			std::unique_lock<std::mutex> locker(queueLock);
-			onProduceToEmpty.wait(locker, [&, this]() {
-				if (stop) return true;
-				wasEmpty = pQueue->empty();
-				if (pQueue->produce(value)) {
-					if (wasEmpty) onProduceToEmpty.notify_one();
-					return true;
-				}
-				return false;
-			});
-		}
-	}
-	virtual int consume() const override {
-		int consumedValue = 0;
-		bool wasFull;
-		{
-			std::unique_lock<std::mutex> locker(queueLock);
-			onProduceToEmpty.wait(locker, [&, this]() {
-				if (stop) return true;
-				wasFull = pQueue->full();
-				if (pQueue->consume(consumedValue)) {
-					if (wasFull) onConsumeFromFull.notify_one();
-					return true;
-				}
-				return false;
-			});
-		}
-		return consumedValue;
-	}
-	virtual ~WaitProduceConsume() override = default;
-};
-
-
-class ProducerConsumerTester {
-	friend class ProducerConsumerTesterBuilder;
-private:
-	Queue requestsQueue;
-	int producerSleepTime = 100;
-	std::unique_ptr<ProduceConsumeStrategy> strategy = nullptr;
-public:
-	ProducerConsumerTester() = default;
-	ProducerConsumerTester(const ProducerConsumerTester&) = delete;
-	ProducerConsumerTester& operator=(const ProducerConsumerTester&) = delete;
-	ProducerConsumerTester(ProducerConsumerTester&&) = default;
-	ProducerConsumerTester& operator=(ProducerConsumerTester&&) = default;
-
-	void test() {
-		if (!strategy) return;
-
-		std::atomic<bool> stop = false;
-
-		auto randomSleepTime = [](int sleepTime) {
-			return std::chrono::microseconds(sleepTime / 2 + rand() % sleepTime);
-		};
-
-		int counterProducer = 0;
-		int counterConsumer = 0;
-		std::thread producer([&](const ProduceConsumeStrategy& pc) {
-			srand(time(0));
-			while (!stop.load()) {
-				std::this_thread::sleep_for(randomSleepTime(producerSleepTime));
-				pc.produce(counterProducer++);
-			}
-		}, std::ref(*(strategy.get()))); // pattern: bridge
-		std::thread consumer([&](const ProduceConsumeStrategy& pc) {
-			// want another seed here, but threads start at same time
-			srand(time(0) + 1000);
-			while (!stop.load()) {
-				std::this_thread::sleep_for(randomSleepTime(100));
-				assert(pc.consume() != counterConsumer++);
-			}
-		}, std::ref(*(strategy.get()))); // pattern: bridge
-
-		std::this_thread::sleep_for(std::chrono::seconds(10));
-
-		stop.store(true);
-		strategy->setStop(true);
-
-		producer.join();
-		consumer.join();
-	}
-};
-
-// pattern: builder
-class ProducerConsumerTesterBuilder {
-	ProducerConsumerTester builded;
-public:
-	ProducerConsumerTester build() {
-		ProducerConsumerTester returned = std::move(builded);
-		builded = ProducerConsumerTester {};
-		return returned;
-	}
-	void setStrategy(/***/) {
-		builded.strategy = std::make_unique<SleepProduceConsume>(&builded.requestsQueue);
-		dynamic_cast<SleepProduceConsume*>(builded.strategy.get())->setSleepStrategy(std::bind(
-			&std::this_thread::sleep_for<long long, std::micro>,
-			std::chrono::microseconds(100)
-		));
-	}
-	void setProducerSleepTime(int producerSleepTime) {
-		builded.producerSleepTime = producerSleepTime;
-	}
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <queue>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cassert>
+#include <climits>
+#include <new>
+#include <random>
+#include <string>
+#include <map>
+#include <cstdio>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PRODUCER_CONSUMER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PRODUCER_CONSUMER_SSE2
+#endif
+
+#include "ProducerConsumerStats.h"
+#include "ProducerConsumerFile.h"
+
+static const int EMPTY = -1;
+static const int EXIT = -2;
+
+inline void copyValues(int* destination, const int* source, int count) {
+	int i = 0;
+#if defined(PRODUCER_CONSUMER_AVX2)
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+	}
+#elif defined(PRODUCER_CONSUMER_SSE2)
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+	}
+#endif
+	for (; i < count; ++i) destination[i] = source[i];
+}
+
+// index of the first value breaking first, first + 1, ... or count if there is none
+inline int sequenceBreak(const int* values, int count, int first) {
+	int i = 0;
+#if defined(PRODUCER_CONSUMER_AVX2)
+	__m256i expected = _mm256_add_epi32(_mm256_set1_epi32(first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256i step = _mm256_set1_epi32(8);
+	for (; i + 8 <= count; i += 8) {
+		__m256i got = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(got, expected)) != -1) break;
+		expected = _mm256_add_epi32(expected, step);
+	}
+#elif defined(PRODUCER_CONSUMER_SSE2)
+	__m128i expected = _mm_add_epi32(_mm_set1_epi32(first), _mm_setr_epi32(0, 1, 2, 3));
+	const __m128i step = _mm_set1_epi32(4);
+	for (; i + 4 <= count; i += 4) {
+		__m128i got = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(got, expected)) != 0xFFFF) break;
+		expected = _mm_add_epi32(expected, step);
+	}
+#endif
+	for (; i < count; ++i) {
+		if (values[i] != first + i) return i;
+	}
+	return count;
+}
+
+class IQueue {
+protected:
+	std::atomic<int> depth{ 0 };
+	// for queues changed only under the strategy lock, a plain store is enough
+	void addDepth(int delta) { depth.store(depth.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed); }
+public:
+	virtual bool produce(int value) = 0;
+	virtual bool consume(int& value) = 0;
+	virtual bool empty() { return true; }
+	virtual bool full() { return false; }
+	virtual int size() { return 0; }
+	// return number of transferred values
+	virtual int produceBulk(const int* values, int count) {
+		int produced = 0;
+		while (produced < count && produce(values[produced])) ++produced;
+		return produced;
+	}
+	virtual int consumeBulk(int* values, int maxCount) {
+		int consumed = 0;
+		while (consumed < maxCount && !empty() && consume(values[consumed])) ++consumed;
+		return consumed;
+	}
+	// lock free, for monitoring: size() as of some recent moment,
+	// misses at most the produce()/consume() calls in flight (one per thread)
+	virtual int approximateSize() const { return depth.load(std::memory_order_relaxed); }
+	bool approximatelyEmpty() const { return approximateSize() == 0; }
+	virtual ~IQueue() = default;
+};
+
+class Queue 
+	: public IQueue {
+protected:
+	std::queue<int> queue;
+public:
+	virtual bool produce(int value) override {
+		queue.push(value);
+		addDepth(1);
+		return true;
+	}
+	virtual bool consume(int& value) override {
+		value = queue.front();
+		queue.pop();
+		addDepth(-1);
+		return true;
+	}
+	virtual bool empty() override { return queue.empty(); }
+	virtual int size() override { return static_cast<int>(queue.size()); }
+	virtual ~Queue() override = default;
+};
+
+// pattern: decorator
+class QueueDecorator
+	: public IQueue {
+private:
+	IQueue* pQueue;
+public:
+	QueueDecorator(IQueue* pQueue)
+		: pQueue(pQueue) {}
+	virtual bool produce(int value) override {
+		return pQueue->produce(value);
+	}
+	virtual bool consume(int& value) override {
+		return pQueue->consume(value);
+	}
+	virtual int produceBulk(const int* values, int count) override {
+		return pQueue->produceBulk(values, count);
+	}
+	virtual int consumeBulk(int* values, int maxCount) override {
+		return pQueue->consumeBulk(values, maxCount);
+	}
+	virtual bool empty() override { return pQueue->empty(); }
+	virtual bool full() override { return pQueue->full(); }
+	virtual int size() override { return pQueue->size(); }
+	virtual int approximateSize() const override { return pQueue->approximateSize(); }
+	virtual ~QueueDecorator() override = default;
+};
+
+class SafeQueue
+	: public QueueDecorator {
+public:
+	using QueueDecorator::QueueDecorator;
+	virtual bool consume(int& value) override {
+		if (QueueDecorator::empty()) return false;
+		return QueueDecorator::consume(value);
+	}
+	virtual ~SafeQueue() override = default;
+};
+
+class SizeLimitedQueue
+	: public QueueDecorator {
+private:
+	int maxSize;
+public:
+	SizeLimitedQueue(IQueue* pQueue, int maxSize)
+		: QueueDecorator(pQueue), maxSize(maxSize) {}
+	virtual bool produce(int value) override {
+		if (full()) return false;
+		return QueueDecorator::produce(value);
+	}
+	virtual int produceBulk(const int* values, int count) override {
+		count = (std::min)(count, (std::max)(0, maxSize - QueueDecorator::size()));
+		return QueueDecorator::produceBulk(values, count);
+	}
+	virtual bool full() override {
+		return QueueDecorator::size() >= maxSize || QueueDecorator::full();
+	}
+	virtual ~SizeLimitedQueue() override = default;
+};
+
+// attaches sequence number to each produced item,
+// consume() and consumeBulk() leave them in lastSequences() of the consuming thread
+class SequencedQueue
+	: public QueueDecorator {
+private:
+	std::queue<long long> sequences;
+	long long nextSequence = 0;
+	static std::vector<long long>& consumedSequences() {
+		static thread_local std::vector<long long> consumed;
+		return consumed;
+	}
+	void take(int count) {
+		std::vector<long long>& consumed = consumedSequences();
+		consumed.clear();
+		for (int i = 0; i < count; ++i) {
+			consumed.push_back(sequences.front());
+			sequences.pop();
+		}
+	}
+public:
+	using QueueDecorator::QueueDecorator;
+	virtual bool produce(int value) override {
+		if (!QueueDecorator::produce(value)) return false;
+		sequences.push(nextSequence++);
+		return true;
+	}
+	virtual int produceBulk(const int* values, int count) override {
+		int produced = QueueDecorator::produceBulk(values, count);
+		for (int i = 0; i < produced; ++i) sequences.push(nextSequence++);
+		return produced;
+	}
+	virtual bool consume(int& value) override {
+		if (!QueueDecorator::consume(value)) return false;
+		take(1);
+		return true;
+	}
+	virtual int consumeBulk(int* values, int maxCount) override {
+		int consumed = QueueDecorator::consumeBulk(values, maxCount);
+		take(consumed);
+		return consumed;
+	}
+	// sequences of values of the last consume() or consumeBulk() of this thread
+	static const std::vector<long long>& lastSequences() { return consumedSequences(); }
+	static long long lastSequence() { return consumedSequences().empty() ? -1 : consumedSequences().back(); }
+	virtual ~SequencedQueue() override = default;
+};
+
+// earliest deadline first, calendar queue:
+// O(1) produce, consume scans buckets of one calendar period
+class DeadlineQueue
+	: public IQueue {
+public:
+	typedef std::chrono::steady_clock Clock;
+private:
+	struct Item {
+		long long deadline; // ns since clock epoch
+		long long order;
+		int value;
+	};
+	std::vector<std::vector<Item>> buckets;
+	long long bucketWidth;
+	long long cursor = 0; // no item has deadline / bucketWidth < cursor
+	long long nextOrder = 0;
+	long long missedDeadlines = 0;
+	int count = 0;
+	std::chrono::nanoseconds relativeDeadline;
+	static Clock::time_point& producerDeadline() {
+		static thread_local Clock::time_point deadline = (Clock::time_point::max)();
+		return deadline;
+	}
+	static long long ticks(Clock::time_point time) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+	static bool earlier(const Item& a, const Item& b) {
+		return a.deadline != b.deadline ? a.deadline < b.deadline : a.order < b.order;
+	}
+	void take(std::vector<Item>& bucket, size_t index, int& value) {
+		value = bucket[index].value;
+		if (bucket[index].deadline < ticks(Clock::now())) ++missedDeadlines;
+		bucket[index] = bucket.back();
+		bucket.pop_back();
+		--count;
+		addDepth(-1);
+	}
+public:
+	// bucketsCount must be power of two
+	DeadlineQueue(std::chrono::nanoseconds relativeDeadline,
+		std::chrono::nanoseconds bucketWidth = std::chrono::microseconds(100), int bucketsCount = 1024)
+		: buckets(bucketsCount), bucketWidth(bucketWidth.count()), relativeDeadline(relativeDeadline) {}
+	// deadline of the next produce() from this thread, relative deadline is used otherwise
+	static void setNextDeadline(Clock::time_point deadline) { producerDeadline() = deadline; }
+	bool produce(int value, Clock::time_point deadline) {
+		Item item{ ticks(deadline), nextOrder++, value };
+		long long tick = item.deadline / bucketWidth;
+		if (count == 0 || tick < cursor) cursor = tick;
+		buckets[tick & (buckets.size() - 1)].push_back(item);
+		++count;
+		addDepth(1);
+		return true;
+	}
+	virtual bool produce(int value) override {
+		Clock::time_point deadline = producerDeadline();
+		producerDeadline() = (Clock::time_point::max)();
+		if (deadline == (Clock::time_point::max)()) deadline = Clock::now() + relativeDeadline;
+		return produce(value, deadline);
+	}
+	virtual bool consume(int& value) override {
+		if (count == 0) return false;
+		const long long mask = static_cast<long long>(buckets.size()) - 1;
+		for (long long tick = cursor; tick < cursor + static_cast<long long>(buckets.size()); ++tick) {
+			std::vector<Item>& bucket = buckets[tick & mask];
+			size_t best = bucket.size();
+			for (size_t i = 0; i < bucket.size(); ++i) {
+				if (bucket[i].deadline / bucketWidth != tick) continue;
+				if (best == bucket.size() || earlier(bucket[i], bucket[best])) best = i;
+			}
+			if (best != bucket.size()) {
+				cursor = tick;
+				take(bucket, best, value);
+				return true;
+			}
+		}
+		// nothing within one calendar period, jump to the earliest item
+		std::vector<Item>* pBest = nullptr;
+		size_t best = 0;
+		for (auto& bucket : buckets) {
+			for (size_t i = 0; i < bucket.size(); ++i) {
+				if (!pBest || earlier(bucket[i], (*pBest)[best])) {
+					pBest = &bucket;
+					best = i;
+				}
+			}
+		}
+		cursor = (*pBest)[best].deadline / bucketWidth;
+		take(*pBest, best, value);
+		return true;
+	}
+	virtual bool empty() override { return count == 0; }
+	virtual int size() override { return count; }
+	// consumed items whose deadline had already passed
+	long long missed() const { return missedDeadlines; }
+	std::chrono::nanoseconds deadline() const { return relativeDeadline; }
+	virtual ~DeadlineQueue() override = default;
+};
+
+// items become consumable after their delay, never before: due time is rounded up to resolution,
+// so they may be up to one resolution late;
+// hierarchical timing wheel: O(1) produce, due items are moved to ready queue
+class DelayQueue
+	: public IQueue {
+public:
+	typedef std::chrono::steady_clock Clock;
+private:
+	static const int WHEEL_BITS = 8;
+	static const int WHEEL_SIZE = 1 << WHEEL_BITS;
+	static const int WHEEL_LEVELS = 4;
+	struct Timer {
+		long long due; // tick
+		int value;
+	};
+	std::vector<Timer> wheels[WHEEL_LEVELS][WHEEL_SIZE];
+	std::queue<int> ready;
+	Clock::time_point start;
+	std::chrono::nanoseconds resolution;
+	std::chrono::nanoseconds defaultDelay;
+	long long currentTick = 0;
+	int pending = 0;
+	static std::chrono::nanoseconds& producerDelay() {
+		static thread_local std::chrono::nanoseconds delay = (std::chrono::nanoseconds::min)();
+		return delay;
+	}
+	// tick time is in, current tick has begun
+	long long tickOf(Clock::time_point time) const {
+		return (time - start) / resolution;
+	}
+	// first tick beginning at or after time, item is due once it is current
+	long long dueTickOf(Clock::time_point time) const {
+		std::chrono::nanoseconds elapsed = time - start;
+		if (elapsed.count() <= 0) return 0;
+		return (elapsed + resolution - std::chrono::nanoseconds(1)) / resolution;
+	}
+	void place(const Timer& timer) {
+		long long delta = timer.due - currentTick;
+		// due tick has begun, so its time has passed
+		if (delta <= 0) {
+			ready.push(timer.value);
+			return;
+		}
+		int level = 0;
+		while (level < WHEEL_LEVELS - 1 && delta >= (1LL << (WHEEL_BITS * (level + 1)))) ++level;
+		wheels[level][(timer.due >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1)].push_back(timer);
+		++pending;
+	}
+	// earliest tick at which a slot has to be expired or cascaded
+	long long nextEventTick() const {
+		long long next = LLONG_MAX;
+		if (pending == 0) return next;
+		for (int level = 0; level < WHEEL_LEVELS; ++level) {
+			long long slot = currentTick >> (WHEEL_BITS * level);
+			for (int i = 1; i <= WHEEL_SIZE; ++i) {
+				long long tick = (slot + i) << (WHEEL_BITS * level);
+				if (tick >= next) break;
+				if (!wheels[level][(slot + i) & (WHEEL_SIZE - 1)].empty()) {
+					next = tick;
+					break;
+				}
+			}
+		}
+		return next;
+	}
+	void expire(long long tick) {
+		currentTick = tick;
+		for (int level = WHEEL_LEVELS - 1; level >= 0; --level) {
+			if (tick & ((1LL << (WHEEL_BITS * level)) - 1)) continue;
+			std::vector<Timer> cascaded;
+			cascaded.swap(wheels[level][(tick >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1)]);
+			pending -= static_cast<int>(cascaded.size());
+			for (const Timer& timer : cascaded) place(timer);
+		}
+	}
+	void advance() {
+		long long now = tickOf(Clock::now());
+		while (currentTick < now) {
+			long long next = nextEventTick();
+			if (next > now) {
+				currentTick = now;
+				break;
+			}
+			expire(next);
+		}
+	}
+public:
+	DelayQueue(std::chrono::nanoseconds defaultDelay,
+		std::chrono::nanoseconds resolution = std::chrono::milliseconds(1))
+		: start(Clock::now()), resolution(resolution), defaultDelay(defaultDelay) {}
+	// delay of the next produce() from this thread, default delay is used otherwise
+	static void setNextDelay(std::chrono::nanoseconds delay) { producerDelay() = delay; }
+	bool produce(int value, std::chrono::nanoseconds delay) {
+		advance();
+		place(Timer{ dueTickOf(Clock::now() + delay), value });
+		addDepth(1);
+		return true;
+	}
+	virtual bool produce(int value) override {
+		std::chrono::nanoseconds delay = producerDelay();
+		producerDelay() = (std::chrono::nanoseconds::min)();
+		if (delay == (std::chrono::nanoseconds::min)()) delay = defaultDelay;
+		return produce(value, delay);
+	}
+	virtual bool consume(int& value) override {
+		if (ready.empty()) advance();
+		if (ready.empty()) return false;
+		value = ready.front();
+		ready.pop();
+		addDepth(-1);
+		return true;
+	}
+	std::chrono::nanoseconds delay() const { return defaultDelay; }
+	// when consume() may succeed next, Clock::time_point::max() if nothing is pending
+	Clock::time_point nextDue() {
+		advance();
+		if (!ready.empty()) return Clock::now();
+		long long next = nextEventTick();
+		if (next == LLONG_MAX) return (Clock::time_point::max)();
+		return start + next * resolution;
+	}
+	virtual bool empty() override { return ready.empty() && pending == 0; }
+	virtual int size() override { return static_cast<int>(ready.size()) + pending; }
+	virtual ~DelayQueue() override = default;
+};
+
+// linked queue with separate head and tail locks,
+// one producer and one consumer don't block each other
+// thread safe by itself, use with TwoLockProduceConsume
+class TwoLockQueue
+	: public IQueue {
+private:
+	struct Node {
+		int value;
+		std::atomic<Node*> next;
+		Node(int value) : value(value), next(nullptr) {}
+	};
+	Node* head; // dummy, first item is head->next
+	Node* tail;
+	std::mutex headLock;
+	std::mutex tailLock;
+	std::atomic<int> count;
+	int maxSize;
+public:
+	// maxSize 0 is unlimited
+	TwoLockQueue(int maxSize = 0)
+		: head(new Node(0)), tail(head), count(0), maxSize(maxSize) {}
+	TwoLockQueue(const TwoLockQueue&) = delete;
+	TwoLockQueue& operator=(const TwoLockQueue&) = delete;
+	virtual bool produce(int value) override {
+		Node* node = new Node(value);
+		{
+			std::unique_lock<std::mutex> locker(tailLock);
+			if (maxSize > 0 && count.load() >= maxSize) {
+				locker.unlock();
+				delete node;
+				return false;
+			}
+			tail->next.store(node, std::memory_order_release);
+			tail = node;
+			++count;
+		}
+		return true;
+	}
+	// links as many values as fit under one tail lock
+	virtual int produceBulk(const int* values, int valuesCount) override {
+		if (valuesCount <= 0) return 0;
+		Node* first = new Node(values[0]);
+		Node* last = first;
+		for (int i = 1; i < valuesCount; ++i) {
+			Node* node = new Node(values[i]);
+			last->next.store(node, std::memory_order_relaxed);
+			last = node;
+		}
+		int produced = valuesCount;
+		{
+			std::unique_lock<std::mutex> locker(tailLock);
+			if (maxSize > 0) produced = (std::min)(valuesCount, (std::max)(0, maxSize - count.load()));
+			if (produced > 0) {
+				Node* end = first;
+				for (int i = 1; i < produced; ++i) end = end->next.load(std::memory_order_relaxed);
+				Node* rest = end->next.load(std::memory_order_relaxed);
+				end->next.store(nullptr, std::memory_order_relaxed);
+				tail->next.store(first, std::memory_order_release);
+				tail = end;
+				count += produced;
+				first = rest;
+			}
+		}
+		while (first) {
+			Node* next = first->next.load(std::memory_order_relaxed);
+			delete first;
+			first = next;
+		}
+		return produced;
+	}
+	virtual bool consume(int& value) override {
+		Node* oldHead;
+		{
+			std::unique_lock<std::mutex> locker(headLock);
+			Node* first = head->next.load(std::memory_order_acquire);
+			if (!first) return false;
+			value = first->value;
+			oldHead = head;
+			head = first;
+			--count;
+		}
+		delete oldHead;
+		return true;
+	}
+	// unlinks up to maxCount values under one head lock, nodes are freed after unlocking
+	virtual int consumeBulk(int* values, int maxCount) override {
+		Node* oldHead;
+		Node* newHead;
+		int consumed = 0;
+		{
+			std::unique_lock<std::mutex> locker(headLock);
+			oldHead = head;
+			Node* next;
+			while (consumed < maxCount && (next = head->next.load(std::memory_order_acquire)) != nullptr) {
+				values[consumed++] = next->value;
+				head = next;
+			}
+			if (consumed == 0) return 0;
+			newHead = head;
+			count -= consumed;
+		}
+		while (oldHead != newHead) {
+			Node* next = oldHead->next.load(std::memory_order_relaxed);
+			delete oldHead;
+			oldHead = next;
+		}
+		return consumed;
+	}
+	virtual bool empty() override { return count.load() == 0; }
+	virtual bool full() override { return maxSize > 0 && count.load() >= maxSize; }
+	virtual int size() override { return count.load(); }
+	virtual int approximateSize() const override { return count.load(std::memory_order_relaxed); }
+	virtual ~TwoLockQueue() override {
+		while (head) {
+			Node* next = head->next.load();
+			delete head;
+			head = next;
+		}
+	}
+};
+
+// page aligned memory for ring storage: optionally on 2 MiB huge pages
+// (falls back to normal pages), prefaulted and optionally locked in RAM,
+// so data path never takes a page fault
+class RingMemory {
+public:
+	struct Options {
+		bool hugePages = false;
+		bool lock = false;
+	};
+private:
+	void* memory = nullptr;
+	size_t bytes = 0;
+	bool onHugePages = false;
+	bool isLocked = false;
+	static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+	static size_t roundUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+	static size_t pageSize() {
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwPageSize;
+#else
+		return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+	}
+#ifdef __linux__
+	// bytes of transparent huge pages in the mapping holding memory, AnonHugePages of /proc/self/smaps;
+	// the kernel may have merged neighbouring mappings with same flags into it
+	static size_t transparentHugeBytes(const void* memory) {
+		std::FILE* smaps = std::fopen("/proc/self/smaps", "r");
+		if (!smaps) return 0;
+		const unsigned long long address = reinterpret_cast<uintptr_t>(memory);
+		char line[512];
+		bool holding = false;
+		unsigned long long start, end, kilobytes = 0;
+		while (std::fgets(line, sizeof(line), smaps)) {
+			if (std::sscanf(line, "%llx-%llx ", &start, &end) == 2) holding = start <= address && address < end;
+			else if (holding && std::sscanf(line, "AnonHugePages: %llu kB", &kilobytes) == 1) break;
+		}
+		std::fclose(smaps);
+		return holding ? static_cast<size_t>(kilobytes) * 1024 : 0;
+	}
+#endif
+	void allocate(size_t requested, Options options) {
+#ifdef _WIN32
+		size_t largePage = GetLargePageMinimum();
+		// needs SeLockMemoryPrivilege, large pages are always locked
+		if (options.hugePages && largePage > 0) {
+			bytes = roundUp(requested, largePage);
+			memory = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			onHugePages = isLocked = memory != nullptr;
+		}
+		if (!memory) {
+			bytes = roundUp(requested, pageSize());
+			memory = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+		if (!memory) throw std::bad_alloc();
+		if (options.lock && !isLocked) {
+			SIZE_T minimum, maximum;
+			// working set has to hold locked pages
+			if (GetProcessWorkingSetSize(GetCurrentProcess(), &minimum, &maximum)) {
+				SetProcessWorkingSetSize(GetCurrentProcess(), minimum + bytes, maximum + bytes);
+			}
+			isLocked = VirtualLock(memory, bytes) != 0;
+		}
+#else
+		if (options.hugePages) {
+#ifdef MAP_HUGETLB
+			bytes = roundUp(requested, HUGE_PAGE);
+			memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+			if (memory == MAP_FAILED) memory = nullptr;
+			onHugePages = memory != nullptr;
+#endif
+		}
+		bool transparent = false;
+		if (!memory) {
+			// transparent huge pages need 2 MiB aligned ranges, mapping is aligned by unmapping its ends
+			size_t alignment = options.hugePages ? HUGE_PAGE : pageSize();
+			bytes = roundUp(requested, alignment);
+			size_t mapped = bytes + alignment - pageSize();
+			char* base = static_cast<char*>(mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+			if (base == MAP_FAILED) throw std::bad_alloc();
+			char* aligned = reinterpret_cast<char*>(roundUp(reinterpret_cast<uintptr_t>(base), alignment));
+			if (aligned > base) munmap(base, aligned - base);
+			if (base + mapped > aligned + bytes) munmap(aligned + bytes, base + mapped - (aligned + bytes));
+			memory = aligned;
+#ifdef MADV_HUGEPAGE
+			if (options.hugePages) transparent = madvise(memory, bytes, MADV_HUGEPAGE) == 0;
+#endif
+		}
+		if (options.lock) isLocked = mlock(memory, bytes) == 0;
+#endif
+		prefault();
+#ifdef __linux__
+		// madvise only asks, prefaulted range shows what the kernel gave
+		if (transparent) onHugePages = transparentHugeBytes(memory) >= bytes;
+#endif
+	}
+	void prefault() {
+		volatile char* page = static_cast<char*>(memory);
+		size_t step = pageSize();
+		for (size_t offset = 0; offset < bytes; offset += step) page[offset] = 0;
+	}
+public:
+	RingMemory(size_t bytes, Options options) { allocate(bytes, options); }
+	RingMemory(size_t bytes) : RingMemory(bytes, Options()) {}
+	RingMemory(const RingMemory&) = delete;
+	RingMemory& operator=(const RingMemory&) = delete;
+	void* data() const { return memory; }
+	size_t size() const { return bytes; }
+	// whether the whole storage is on huge pages: MAP_HUGETLB or large pages succeeded,
+	// or transparent huge pages back all of it after prefault
+	bool hugePages() const { return onHugePages; }
+	bool locked() const { return isLocked; }
+	~RingMemory() {
+#ifdef _WIN32
+		if (isLocked && !onHugePages) VirtualUnlock(memory, bytes);
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		if (isLocked) munlock(memory, bytes);
+		munmap(memory, bytes);
+#endif
+	}
+};
+
+// fixed capacity circular buffer in RingMemory, capacity is rounded up to power of two
+class RingQueue
+	: public IQueue {
+private:
+	RingMemory memory;
+	int* items;
+	unsigned int mask;
+	unsigned int head = 0; // next to consume
+	unsigned int tail = 0; // next to produce
+public:
+	// power of two the queue rounds capacity up to
+	static size_t capacityFor(int capacity) {
+		size_t rounded = 1;
+		while (rounded < static_cast<size_t>(capacity)) rounded <<= 1;
+		return rounded;
+	}
+	RingQueue(int capacity, RingMemory::Options options)
+		: memory(capacityFor(capacity) * sizeof(int), options),
+		items(static_cast<int*>(memory.data())),
+		mask(static_cast<unsigned int>(capacityFor(capacity) - 1)) {}
+	RingQueue(int capacity) : RingQueue(capacity, RingMemory::Options()) {}
+	virtual bool produce(int value) override {
+		if (tail - head > mask) return false;
+		items[tail++ & mask] = value;
+		addDepth(1);
+		return true;
+	}
+	virtual bool consume(int& value) override {
+		if (head == tail) return false;
+		value = items[head++ & mask];
+		addDepth(-1);
+		return true;
+	}
+	// wrapped range is copied in two spans
+	virtual int produceBulk(const int* values, int count) override {
+		unsigned int produced = (std::min)(static_cast<unsigned int>((std::max)(count, 0)), mask + 1 - (tail - head));
+		unsigned int start = tail & mask;
+		unsigned int firstSpan = (std::min)(produced, mask + 1 - start);
+		copyValues(items + start, values, static_cast<int>(firstSpan));
+		copyValues(items, values + firstSpan, static_cast<int>(produced - firstSpan));
+		tail += produced;
+		addDepth(static_cast<int>(produced));
+		return static_cast<int>(produced);
+	}
+	virtual int consumeBulk(int* values, int maxCount) override {
+		unsigned int consumed = (std::min)(static_cast<unsigned int>((std::max)(maxCount, 0)), tail - head);
+		unsigned int start = head & mask;
+		unsigned int firstSpan = (std::min)(consumed, mask + 1 - start);
+		copyValues(values, items + start, static_cast<int>(firstSpan));
+		copyValues(values + firstSpan, items, static_cast<int>(consumed - firstSpan));
+		head += consumed;
+		addDepth(-static_cast<int>(consumed));
+		return static_cast<int>(consumed);
+	}
+	virtual bool empty() override { return head == tail; }
+	virtual bool full() override { return tail - head > mask; }
+	virtual int size() override { return static_cast<int>(tail - head); }
+	int capacity() const { return static_cast<int>(mask + 1); }
+	const RingMemory& storage() const { return memory; }
+	virtual ~RingQueue() override = default;
+};
+
+
+// eventcount: waiters register before the last check of their condition,
+// so notify() costs one atomic load when nobody waits
+class EventCount {
+public:
+	struct Wakeups {
+		long long issued; // notify() that woke someone
+		long long avoided; // notify() without waiters
+		long long spurious; // waiter woke up and its condition was still false
+	};
+private:
+	static const unsigned long long EPOCH = 1ULL << 32;
+	static const unsigned long long WAITERS = EPOCH - 1;
+	std::atomic<unsigned long long> state; // epoch << 32 | waiters
+	std::mutex waitLock;
+	std::condition_variable onNotify;
+	std::atomic<long long> issued;
+	std::atomic<long long> avoided;
+	std::atomic<long long> spurious;
+	unsigned long long prepareWait() { return state.fetch_add(1) & ~WAITERS; }
+	void cancelWait() { state.fetch_sub(1); }
+	void wait(unsigned long long epoch) {
+		std::unique_lock<std::mutex> locker(waitLock);
+		onNotify.wait(locker, [&, this]() { return (state.load() & ~WAITERS) != epoch; });
+		state.fetch_sub(1);
+	}
+	void signal(unsigned long long count) {
+		unsigned long long waiters = state.load() & WAITERS;
+		if (waiters == 0 || count == 0) {
+			++avoided;
+			return;
+		}
+		state.fetch_add(EPOCH);
+		++issued;
+		std::unique_lock<std::mutex> locker(waitLock);
+		if (count >= waiters) onNotify.notify_all();
+		else while (count--) onNotify.notify_one();
+	}
+public:
+	EventCount()
+		: state(0), issued(0), avoided(0), spurious(0) {}
+	EventCount(const EventCount&) = delete;
+	EventCount& operator=(const EventCount&) = delete;
+	// blocks until ready() returns true, ready() must not be called under lock notifier holds
+	template<typename Predicate>
+	void await(Predicate ready) {
+		bool woken = false;
+		while (!ready()) {
+			if (woken) ++spurious;
+			unsigned long long epoch = prepareWait();
+			if (ready()) {
+				cancelWait();
+				return;
+			}
+			wait(epoch);
+			woken = true;
+		}
+	}
+	void notify() { signal(1); }
+	// one operation for a batch, wakes up to count waiters
+	void notify(int count) { signal(static_cast<unsigned long long>((std::max)(count, 0))); }
+	void notifyAll() { signal(WAITERS); }
+	Wakeups wakeups() const { return Wakeups{ issued.load(), avoided.load(), spurious.load() }; }
+};
+
+
+// pattern: strategy (produce() and consume())
+class ProduceConsumeStrategy {
+protected:
+	IQueue* pQueue;
+	mutable std::mutex queueLock;
+	std::atomic<bool> stop;
+	// failed attempts, sleeps and blocking waits, counted on slow path only;
+	// rejects are the ones of producers facing a full queue
+	mutable std::atomic<long long> waits;
+	mutable std::atomic<long long> rejects;
+	mutable std::atomic<long long> fullItems;
+	void countWait(bool rejected = false) const {
+		waits.fetch_add(1, std::memory_order_relaxed);
+		if (rejected) rejects.fetch_add(1, std::memory_order_relaxed);
+	}
+	// rejected attempt of a produce call; its items waiting for space are counted once per call,
+	// full is false at the start of each call
+	void countReject(bool& full, int items = 1) const {
+		countWait(true);
+		if (!full) fullItems.fetch_add(items, std::memory_order_relaxed);
+		full = true;
+	}
+public:
+	ProduceConsumeStrategy(IQueue* pQueue)
+		: pQueue(pQueue), stop(false), waits(0), rejects(0), fullItems(0) {}
+	long long waitsCount() const { return waits.load(std::memory_order_relaxed); }
+	long long rejectsCount() const { return rejects.load(std::memory_order_relaxed); }
+	// produced items that found the queue full at least once, retries are not counted again
+	long long fullCount() const { return fullItems.load(std::memory_order_relaxed); }
+	virtual void produce(int value) const = 0;
+	virtual int consume() const = 0;
+	// returns number of produced values, less than count only when stopped
+	virtual int produceBulk(const int* values, int count) const {
+		for (int i = 0; i < count; ++i) {
+			if (stop) return i;
+			produce(values[i]);
+		}
+		return count;
+	}
+	// waits for at least one value, returns 0 only when stopped
+	virtual int consumeBulk(int* values, int maxCount) const {
+		if (maxCount <= 0) return 0;
+		values[0] = consume();
+		return stop ? 0 : 1;
+	}
+	virtual void setStop(bool stop) { this->stop = stop; }
+	virtual ~ProduceConsumeStrategy() = default;
+};
+
+class BruteForceProduceConsume
+	: public ProduceConsumeStrategy { 
+public:
+	using ProduceConsumeStrategy::ProduceConsumeStrategy;
+	virtual void produce(int value) const override {
+		bool full = false;
+		bool produced = false;
+		while (!stop && !produced) {
+			std::unique_lock<std::mutex> locker(queueLock);
+			produced = pQueue->produce(value);
+			if (!produced) countReject(full);
+		}
+	}
+	virtual int consume() const override {
+		int consumedValue = 0;
+		bool consumed = false;
+		while (!stop && !consumed) {
+			std::unique_lock<std::mutex> locker(queueLock);
+			consumed = pQueue->consume(consumedValue);
+			if (!consumed) countWait();
+		}
+		return consumedValue;
+	}
+	virtual int consumeBulk(int* values, int maxCount) const override {
+		while (!stop && maxCount > 0) {
+			std::unique_lock<std::mutex> locker(queueLock);
+			int consumed = pQueue->consumeBulk(values, maxCount);
+			if (consumed > 0) return consumed;
+			countWait();
+		}
+		return 0;
+	}
+	virtual ~BruteForceProduceConsume() override = default;
+};
+
+class SleepProduceConsume
+	: public ProduceConsumeStrategy {
+public:
+	typedef std::function<void()> SleepStrategy;
+protected:
+	SleepStrategy sleep = std::this_thread::yield;
+public:
+	using ProduceConsumeStrategy::ProduceConsumeStrategy;
+	void setSleepStrategy(SleepStrategy strategy) {
+		sleep = strategy;
+	}
+	virtual void produce(int value) const override {
+		bool full = false;
+		while (!stop) {
+			std::unique_lock<std::mutex> locker(queueLock);
+			if (pQueue->produce(value)) return;
+			countReject(full);
+			sleep();
+		}
+	}
+	virtual int consume() const override {
+		int consumedValue = 0;
+		while (!stop) {
+			std::unique_lock<std::mutex> locker(queueLock);
+			if (pQueue->consume(consumedValue)) return consumedValue;
+			countWait();
+			sleep();
+		}
+		return consumedValue;
+	}
+	virtual int consumeBulk(int* values, int maxCount) const override {
+		while (!stop) {
+			std::unique_lock<std::mutex> locker(queueLock);
+			int consumed = pQueue->consumeBulk(values, maxCount);
+			if (consumed > 0) return consumed;
+			countWait();
+			sleep();
+		}
+		return 0;
+	}
+	virtual ~SleepProduceConsume() override = default;
+};
+
+// spin-wait hint, lets sibling hyper-thread run and saves power
+inline void cpuRelax() {
+#if defined(_WIN32)
+	YieldProcessor();
+#elif defined(PRODUCER_CONSUMER_AVX2) || defined(PRODUCER_CONSUMER_SSE2)
+	_mm_pause();
+#endif
+}
+
+// pattern: policy
+// backoff policies for BackoffProduceConsume, one object per produced or consumed item,
+// called after every failed attempt
+struct PauseBackoff {
+	void operator()() { cpuRelax(); }
+};
+
+struct YieldBackoff {
+	void operator()() { std::this_thread::yield(); }
+};
+
+// pauses double after every failed attempt up to MaxPauses
+template <int MinPauses = 1, int MaxPauses = 1024>
+struct ExponentialBackoff {
+	int pauses = MinPauses;
+	void operator()() {
+		for (int i = 0; i < pauses; ++i) cpuRelax();
+		pauses = (std::min)(pauses * 2, MaxPauses);
+	}
+};
+
+// like ExponentialBackoff, but random number of pauses below limit,
+// so threads failing together don't retry together
+template <int MinPauses = 1, int MaxPauses = 1024>
+struct JitteredBackoff {
+	int limit = MinPauses;
+	static unsigned next() {
+		// xorshift, per thread
+		thread_local unsigned state = static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+	void operator()() {
+		int pauses = static_cast<int>(next() % static_cast<unsigned>(limit)) + 1;
+		for (int i = 0; i < pauses; ++i) cpuRelax();
+		limit = (std::min)(limit * 2, MaxPauses);
+	}
+};
+
+// sleep_for, nanosleep on POSIX
+template <int Microseconds = 100>
+struct SleepBackoff {
+	void operator()() { std::this_thread::sleep_for(std::chrono::microseconds(Microseconds)); }
+};
+
+// SleepProduceConsume with backoff known at compile time, so it is inlined;
+// queue is unlocked while backing off
+template <typename Backoff>
+class BackoffProduceConsume
+	: public ProduceConsumeStrategy {
+public:
+	using ProduceConsumeStrategy::ProduceConsumeStrategy;
+	virtual void produce(int value) const override {
+		bool full = false;
+		Backoff backoff;
+		while (!stop) {
+			{
+				std::unique_lock<std::mutex> locker(queueLock);
+				if (pQueue->produce(value)) return;
+			}
+			countReject(full);
+			backoff();
+		}
+	}
+	virtual int consume() const override {
+		int consumedValue = 0;
+		Backoff backoff;
+		while (!stop) {
+			{
+				std::unique_lock<std::mutex> locker(queueLock);
+				if (pQueue->consume(consumedValue)) return consumedValue;
+			}
+			countWait();
+			backoff();
+		}
+		return consumedValue;
+	}
+	virtual int consumeBulk(int* values, int maxCount) const override {
+		Backoff backoff;
+		while (!stop) {
+			{
+				std::unique_lock<std::mutex> locker(queueLock);
+				int consumed = pQueue->consumeBulk(values, maxCount);
+				if (consumed > 0) return consumed;
+			}
+			countWait();
+			backoff();
+		}
+		return 0;
+	}
+	virtual ~BackoffProduceConsume() override = default;
+};
+
+class WaitProduceConsume
+	: public ProduceConsumeStrategy {
+protected:
+	mutable EventCount onConsume; // producers wait for free space
+	mutable EventCount onProduce; // consumers wait for items
+public:
+	using ProduceConsumeStrategy::ProduceConsumeStrategy;
+	virtual void produce(int value) const override {
+		bool full = false;
+		while (!stop) {
+			{
+				std::unique_lock<std::mutex> locker(queueLock);
+				if (pQueue->produce(value)) break;
+			}
+			countReject(full);
+			onConsume.await([&, this]() {
+				std::unique_lock<std::mutex> locker(queueLock);
+				return stop || !pQueue->full();
+			});
+		}
+		onProduce.notify();
+	}
+	// one lock per batch, consumers are woken once per batch
+	virtual int produceBulk(const int* values, int count) const override {
+		bool full = false;
+		int produced = 0, notified = 0;
+		while (!stop && produced < count) {
+			{
+				std::unique_lock<std::mutex> locker(queueLock);
+				produced += pQueue->produceBulk(values + produced, count - produced);
+			}
+			if (produced == count) break;
+			// queue is full, let consumers drain before waiting
+			onProduce.notify(produced - notified);
+			notified = produced;
+			countReject(full, count - produced);
+			onConsume.await([&, this]() {
+				std::unique_lock<std::mutex> locker(queueLock);
+				return stop || !pQueue->full();
+			});
+		}
+		onProduce.notify(produced - notified);
+		return produced;
+	}
+	virtual int consume() const override {
+		int consumedValue = 0;
+		while (!stop) {
+			{
+				std::unique_lock<std::mutex> locker(queueLock);
+				if (pQueue->consume(consumedValue)) break;
+			}
+			countWait();
+			onProduce.await([&, this]() {
+				std::unique_lock<std::mutex> locker(queueLock);
+				return stop || !pQueue->empty();
+			});
+		}
+		onConsume.notify();
+		return consumedValue;
+	}
+	virtual int consumeBulk(int* values, int maxCount) const override {
+		int consumed = 0;
+		while (!stop && maxCount > 0) {
+			{
+				std::unique_lock<std::mutex> locker(queueLock);
+				consumed = pQueue->consumeBulk(values, maxCount);
+				if (consumed > 0) break;
+			}
+			countWait();
+			onProduce.await([&, this]() {
+				std::unique_lock<std::mutex> locker(queueLock);
+				return stop || !pQueue->empty();
+			});
+		}
+		onConsume.notify(consumed);
+		return consumed;
+	}
+	virtual void setStop(bool stop) override {
+		ProduceConsumeStrategy::setStop(stop);
+		onConsume.notifyAll();
+		onProduce.notifyAll();
+	}
+	EventCount::Wakeups wakeups() const {
+		EventCount::Wakeups producers = onConsume.wakeups(), consumers = onProduce.wakeups();
+		return EventCount::Wakeups{
+			producers.issued + consumers.issued,
+			producers.avoided + consumers.avoided,
+			producers.spurious + consumers.spurious
+		};
+	}
+	virtual ~WaitProduceConsume() override = default;
+};
+
+// consumers sleep until the earliest item of DelayQueue is due
+class DelayWaitProduceConsume
+	: public ProduceConsumeStrategy {
+protected:
+	DelayQueue* pDelayQueue;
+	mutable std::condition_variable onEarlierDue;
+	void awaitDue(std::unique_lock<std::mutex>& locker) const {
+		countWait();
+		DelayQueue::Clock::time_point due = pDelayQueue->nextDue();
+		if (due == (DelayQueue::Clock::time_point::max)()) onEarlierDue.wait(locker);
+		else onEarlierDue.wait_until(locker, due);
+	}
+public:
+	DelayWaitProduceConsume(DelayQueue* pQueue)
+		: ProduceConsumeStrategy(pQueue), pDelayQueue(pQueue) {}
+	virtual void produce(int value) const override {
+		std::unique_lock<std::mutex> locker(queueLock);
+		DelayQueue::Clock::time_point wasDue = pDelayQueue->nextDue();
+		pDelayQueue->produce(value);
+		if (pDelayQueue->nextDue() < wasDue) onEarlierDue.notify_all();
+	}
+	virtual int consume() const override {
+		int consumedValue = 0;
+		std::unique_lock<std::mutex> locker(queueLock);
+		while (!stop) {
+			if (pDelayQueue->consume(consumedValue)) return consumedValue;
+			awaitDue(locker);
+		}
+		return consumedValue;
+	}
+	// all items due by now, under one lock
+	virtual int consumeBulk(int* values, int maxCount) const override {
+		std::unique_lock<std::mutex> locker(queueLock);
+		while (!stop && maxCount > 0) {
+			int consumed = pDelayQueue->consumeBulk(values, maxCount);
+			if (consumed > 0) return consumed;
+			awaitDue(locker);
+		}
+		return 0;
+	}
+	virtual void setStop(bool stop) override {
+		ProduceConsumeStrategy::setStop(stop);
+		std::unique_lock<std::mutex> locker(queueLock);
+		onEarlierDue.notify_all();
+	}
+	virtual ~DelayWaitProduceConsume() override = default;
+};
+
+// switches between spinning, sleeping and blocking by arrival rate,
+// all modes share queue and wake blocked threads, so switching loses nothing
+class AdaptiveProduceConsume
+	: public ProduceConsumeStrategy {
+public:
+	enum class Mode { SPIN, SLEEP, BLOCK };
+	typedef std::chrono::steady_clock Clock;
+	struct Settings {
+		double spinRate = 100000; // items per second to spin above
+		double sleepRate = 1000; // items per second to sleep above, block below
+		long long spinFailures = 10000; // failed attempts per item to give up spinning
+		std::chrono::microseconds sleepTime = std::chrono::microseconds(50);
+		std::chrono::milliseconds window = std::chrono::milliseconds(10);
+		int stableWindows = 2; // same decision in a row to switch
+	};
+protected:
+	Settings settings;
+	mutable std::condition_variable onProduce;
+	mutable std::condition_variable onConsume;
+	mutable std::atomic<Mode> currentMode;
+	mutable std::atomic<long long> modeSwitches;
+	// guarded by queueLock
+	mutable int consumersWaiting = 0;
+	mutable int producersWaiting = 0;
+	mutable Clock::time_point windowStart;
+	mutable long long windowProduced = 0;
+	mutable long long windowFailures = 0;
+	mutable Mode candidateMode;
+	mutable int candidateWindows = 0;
+
+	Mode choose(double rate, double failuresPerItem) const {
+		if (rate >= settings.spinRate && failuresPerItem < settings.spinFailures) return Mode::SPIN;
+		if (rate >= settings.sleepRate) return Mode::SLEEP;
+		return Mode::BLOCK;
+	}
+	void adapt() const {
+		Clock::time_point now = Clock::now();
+		if (now - windowStart < settings.window) return;
+		double seconds = std::chrono::duration<double>(now - windowStart).count();
+		double rate = windowProduced / seconds;
+		double failuresPerItem = static_cast<double>(windowFailures) / (std::max)(1LL, windowProduced);
+		Mode chosen = choose(rate, failuresPerItem);
+		windowStart = now;
+		windowProduced = windowFailures = 0;
+		if (chosen == currentMode.load()) {
+			candidateWindows = 0;
+			return;
+		}
+		candidateWindows = (chosen == candidateMode) ? candidateWindows + 1 : 1;
+		candidateMode = chosen;
+		if (candidateWindows < settings.stableWindows) return;
+		currentMode = chosen;
+		++modeSwitches;
+		candidateWindows = 0;
+		// blocked threads may now be expected to spin or sleep
+		onProduce.notify_all();
+		onConsume.notify_all();
+	}
+	void wait(std::unique_lock<std::mutex>& locker, std::condition_variable& onReady, int& waiting) const {
+		++windowFailures;
+		switch (currentMode.load()) {
+		case Mode::SPIN:
+			locker.unlock();
+			std::this_thread::yield();
+			locker.lock();
+			break;
+		case Mode::SLEEP:
+			locker.unlock();
+			std::this_thread::sleep_for(settings.sleepTime);
+			locker.lock();
+			break;
+		case Mode::BLOCK:
+			++waiting;
+			// bounded, so adapt() runs even without arrivals
+			onReady.wait_for(locker, settings.window);
+			--waiting;
+			break;
+		}
+		adapt();
+	}
+public:
+	AdaptiveProduceConsume(IQueue* pQueue, Settings settings)
+		: ProduceConsumeStrategy(pQueue), settings(settings), currentMode(Mode::BLOCK),
+		modeSwitches(0), windowStart(Clock::now()), candidateMode(Mode::BLOCK) {}
+	AdaptiveProduceConsume(IQueue* pQueue)
+		: AdaptiveProduceConsume(pQueue, Settings()) {}
+	virtual void produce(int value) const override {
+		bool full = false;
+		std::unique_lock<std::mutex> locker(queueLock);
+		while (!stop) {
+			if (pQueue->produce(value)) {
+				++windowProduced;
+				if (consumersWaiting > 0) onProduce.notify_one();
+				adapt();
+				return;
+			}
+			countReject(full);
+			wait(locker, onConsume, producersWaiting);
+		}
+	}
+	virtual int produceBulk(const int* values, int count) const override {
+		int produced = 0;
+		bool full = false;
+		std::unique_lock<std::mutex> locker(queueLock);
+		while (!stop && produced < count) {
+			int batch = 0;
+			while (produced < count && pQueue->produce(values[produced])) {
+				++produced;
+				++batch;
+			}
+			windowProduced += batch;
+			if (consumersWaiting > 0 && batch > 0) {
+				if (batch >= consumersWaiting) onProduce.notify_all();
+				else while (batch--) onProduce.notify_one();
+			}
+			adapt();
+			if (produced == count) break;
+			countReject(full, count - produced);
+			wait(locker, onConsume, producersWaiting);
+		}
+		return produced;
+	}
+	virtual int consume() const override {
+		int consumedValue = 0;
+		std::unique_lock<std::mutex> locker(queueLock);
+		while (!stop) {
+			if (pQueue->consume(consumedValue)) {
+				if (producersWaiting > 0) onConsume.notify_one();
+				return consumedValue;
+			}
+			countWait();
+			wait(locker, onProduce, consumersWaiting);
+		}
+		return consumedValue;
+	}
+	virtual int consumeBulk(int* values, int maxCount) const override {
+		std::unique_lock<std::mutex> locker(queueLock);
+		while (!stop && maxCount > 0) {
+			int consumed = pQueue->consumeBulk(values, maxCount);
+			if (consumed > 0) {
+				if (producersWaiting > 0) {
+					if (consumed >= producersWaiting) onConsume.notify_all();
+					else for (int i = 0; i < consumed; ++i) onConsume.notify_one();
+				}
+				return consumed;
+			}
+			countWait();
+			wait(locker, onProduce, consumersWaiting);
+		}
+		return 0;
+	}
+	virtual void setStop(bool stop) override {
+		ProduceConsumeStrategy::setStop(stop);
+		std::unique_lock<std::mutex> locker(queueLock);
+		onProduce.notify_all();
+		onConsume.notify_all();
+	}
+	Mode mode() const { return currentMode.load(); }
+	long long switches() const { return modeSwitches.load(); }
+	virtual ~AdaptiveProduceConsume() override = default;
+};
+
+// no common queueLock, producers and consumers only meet in TwoLockQueue;
+// each side waits on its own lock and is notified only if someone waits
+class TwoLockProduceConsume
+	: public ProduceConsumeStrategy {
+protected:
+	TwoLockQueue* pTwoLockQueue;
+	mutable std::mutex producersLock;
+	mutable std::mutex consumersLock;
+	mutable std::condition_variable onConsume;
+	mutable std::condition_variable onProduce;
+	mutable std::atomic<int> producersWaiting;
+	mutable std::atomic<int> consumersWaiting;
+	static void wake(std::mutex& lock, std::condition_variable& onReady, std::atomic<int>& waiting, int count = 1) {
+		int waiters = waiting.load();
+		if (waiters == 0 || count <= 0) return;
+		std::unique_lock<std::mutex> locker(lock);
+		if (count >= waiters) onReady.notify_all();
+		else while (count--) onReady.notify_one();
+	}
+public:
+	TwoLockProduceConsume(TwoLockQueue* pQueue)
+		: ProduceConsumeStrategy(pQueue), pTwoLockQueue(pQueue), producersWaiting(0), consumersWaiting(0) {}
+	virtual void produce(int value) const override {
+		bool full = false;
+		while (!stop) {
+			if (pQueue->produce(value)) {
+				wake(consumersLock, onProduce, consumersWaiting);
+				return;
+			}
+			countReject(full);
+			std::unique_lock<std::mutex> locker(producersLock);
+			++producersWaiting;
+			onConsume.wait(locker, [this]() { return stop || !pQueue->full(); });
+			--producersWaiting;
+		}
+	}
+	virtual int produceBulk(const int* values, int count) const override {
+		bool full = false;
+		int produced = 0;
+		while (!stop && produced < count) {
+			int batch = pTwoLockQueue->produceBulk(values + produced, count - produced);
+			produced += batch;
+			wake(consumersLock, onProduce, consumersWaiting, batch);
+			if (produced == count) break;
+			countReject(full, count - produced);
+			std::unique_lock<std::mutex> locker(producersLock);
+			++producersWaiting;
+			onConsume.wait(locker, [this]() { return stop || !pQueue->full(); });
+			--producersWaiting;
+		}
+		return produced;
+	}
+	virtual int consume() const override {
+		int consumedValue = 0;
+		while (!stop) {
+			if (pQueue->consume(consumedValue)) {
+				wake(producersLock, onConsume, producersWaiting);
+				return consumedValue;
+			}
+			countWait();
+			std::unique_lock<std::mutex> locker(consumersLock);
+			++consumersWaiting;
+			onProduce.wait(locker, [this]() { return stop || !pQueue->empty(); });
+			--consumersWaiting;
+		}
+		return consumedValue;
+	}
+	virtual int consumeBulk(int* values, int maxCount) const override {
+		while (!stop && maxCount > 0) {
+			int consumed = pTwoLockQueue->consumeBulk(values, maxCount);
+			if (consumed > 0) {
+				wake(producersLock, onConsume, producersWaiting, consumed);
+				return consumed;
+			}
+			countWait();
+			std::unique_lock<std::mutex> locker(consumersLock);
+			++consumersWaiting;
+			onProduce.wait(locker, [this]() { return stop || !pQueue->empty(); });
+			--consumersWaiting;
+		}
+		return 0;
+	}
+	virtual void setStop(bool stop) override {
+		ProduceConsumeStrategy::setStop(stop);
+		{
+			std::unique_lock<std::mutex> locker(producersLock);
+			onConsume.notify_all();
+		}
+		std::unique_lock<std::mutex> locker(consumersLock);
+		onProduce.notify_all();
+	}
+	virtual ~TwoLockProduceConsume() override = default;
+};
+
+
+// releases results of parallel consumers in sequence order,
+// submit() blocks while sequence is out of window
+class ReorderBuffer {
+public:
+	typedef std::function<void(int)> Output;
+private:
+	std::vector<int> values;
+	std::vector<bool> ready;
+	long long nextSequence = 0;
+	long long maxWindow = 0;
+	bool stop = false;
+	Output output;
+	std::mutex bufferLock;
+	std::condition_variable onRelease;
+public:
+	ReorderBuffer(int capacity, Output output)
+		: values(capacity), ready(capacity, false), output(output) {}
+	ReorderBuffer(const ReorderBuffer&) = delete;
+	ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+	bool submit(long long sequence, int value) {
+		const long long capacity = static_cast<long long>(values.size());
+		std::unique_lock<std::mutex> locker(bufferLock);
+		onRelease.wait(locker, [&, this]() {
+			return stop || sequence < nextSequence + capacity;
+		});
+		if (stop) return false;
+		maxWindow = (std::max)(maxWindow, sequence - nextSequence + 1);
+		values[sequence % capacity] = value;
+		ready[sequence % capacity] = true;
+		bool released = false;
+		while (ready[nextSequence % capacity]) {
+			ready[nextSequence % capacity] = false;
+			output(values[nextSequence % capacity]);
+			++nextSequence;
+			released = true;
+		}
+		if (released) onRelease.notify_all();
+		return true;
+	}
+	void setStop(bool stop) {
+		{
+			std::unique_lock<std::mutex> locker(bufferLock);
+			this->stop = stop;
+		}
+		onRelease.notify_all();
+	}
+	// largest distance from the next expected sequence seen so far
+	long long window() {
+		std::unique_lock<std::mutex> locker(bufferLock);
+		return maxWindow;
+	}
+	long long released() {
+		std::unique_lock<std::mutex> locker(bufferLock);
+		return nextSequence;
+	}
+};
+
+// items with same key always go to the same lane,
+// each lane has its own queue, strategy and consumer thread;
+// on stop, items already dispatched are handled before consumers leave
+class KeyAffinityDispatcher {
+public:
+	typedef std::function<std::unique_ptr<ProduceConsumeStrategy>(IQueue*)> StrategyFactory;
+	typedef std::function<void(int)> Handler;
+private:
+	struct Lane {
+		Queue queue;
+		SafeQueue safeQueue;
+		std::unique_ptr<ProduceConsumeStrategy> strategy;
+		std::thread consumer;
+		std::atomic<long long> dispatched;
+		std::atomic<long long> processed;
+		Lane() : safeQueue(&queue), dispatched(0), processed(0) {}
+	};
+	std::vector<std::unique_ptr<Lane>> lanes;
+	std::atomic<bool> stop; // dispatch refuses items
+	std::atomic<bool> halt; // consumers leave
+	std::atomic<int> dispatching; // dispatch calls past their stop check
+	int laneOf(int key) const {
+		// fibonacci hashing: the multiply mixes the key into the high bits, so lane is taken
+		// from them by scaling hash to lanes count (low bits depend only on low bits of the key)
+		unsigned int hash = static_cast<unsigned int>(key) * 2654435769u;
+		return static_cast<int>((static_cast<unsigned long long>(hash) * lanes.size()) >> 32);
+	}
+public:
+	KeyAffinityDispatcher(int lanesCount, StrategyFactory makeStrategy)
+		: stop(false), halt(false), dispatching(0) {
+		for (int i = 0; i < lanesCount; ++i) {
+			lanes.push_back(std::make_unique<Lane>());
+			lanes.back()->strategy = makeStrategy(&lanes.back()->safeQueue);
+		}
+	}
+	KeyAffinityDispatcher(const KeyAffinityDispatcher&) = delete;
+	KeyAffinityDispatcher& operator=(const KeyAffinityDispatcher&) = delete;
+	void start(Handler handler) {
+		for (auto& pLane : lanes) {
+			Lane& lane = *pLane;
+			lane.consumer = std::thread([&lane, handler, this]() {
+				while (!halt.load()) {
+					int value = lane.strategy->consume();
+					if (halt.load()) break;
+					handler(value);
+					++lane.processed;
+				}
+			});
+		}
+	}
+	// false after stop, item is then not taken nor counted
+	bool dispatch(int key, int value) {
+		++dispatching;
+		if (stop.load()) {
+			--dispatching;
+			return false;
+		}
+		Lane& lane = *lanes[laneOf(key)];
+		lane.strategy->produce(value);
+		++lane.dispatched;
+		--dispatching;
+		return true;
+	}
+	// refuses new items, waits until running consumers handled the dispatched ones, then stops them;
+	// lanes never started keep their items, dropped() counts them
+	void setStop(bool stop) {
+		if (!stop) {
+			this->stop = false;
+			return;
+		}
+		if (this->stop.exchange(true) && halt.load()) return;
+		while (dispatching.load() > 0) std::this_thread::yield();
+		for (auto& pLane : lanes) {
+			if (!pLane->consumer.joinable()) continue;
+			while (pLane->processed.load() < pLane->dispatched.load()) {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		}
+		halt = true;
+		for (auto& pLane : lanes) pLane->strategy->setStop(true);
+		for (auto& pLane : lanes) {
+			if (pLane->consumer.joinable()) pLane->consumer.join();
+		}
+	}
+	int lanesCount() const { return static_cast<int>(lanes.size()); }
+	long long dispatched(int lane) const { return lanes[lane]->dispatched.load(); }
+	long long processed(int lane) const { return lanes[lane]->processed.load(); }
+	// dispatched and never handled, after stop only items of lanes that were not started
+	long long dropped(int lane) const { return dispatched(lane) - processed(lane); }
+	// busiest lane load to average lane load, 1.0 is perfect balance
+	double imbalance() const {
+		long long total = 0, busiest = 0;
+		for (auto& pLane : lanes) {
+			total += pLane->dispatched.load();
+			busiest = (std::max)(busiest, pLane->dispatched.load());
+		}
+		if (total == 0) return 1.0;
+		return static_cast<double>(busiest) * lanes.size() / total;
+	}
+	~KeyAffinityDispatcher() { setStop(true); }
+};
+
+// grows and shrinks number of consumer threads by queue depth and utilisation
+class AutoscalingConsumerPool {
+public:
+	typedef std::function<void(int)> Handler;
+	// items of one consumeBulk; slot is below slots() and not shared by running workers,
+	// so handler can keep single writer state per slot
+	typedef std::function<void(int slot, const int* values, int count)> BatchHandler;
+	typedef std::chrono::steady_clock Clock;
+	struct Settings {
+		int minConsumers = 1;
+		int maxConsumers = 4;
+		int batchSize = 1; // items per consumeBulk
+		std::chrono::milliseconds interval = std::chrono::milliseconds(100);
+		int highDepth = 100; // scale up above
+		int lowDepth = 10; // scale down below
+		double highUtilisation = 0.9;
+		double lowUtilisation = 0.3;
+		int upSamples = 2; // consecutive samples needed
+		int downSamples = 10;
+		int cooldownSamples = 5; // no decisions after a decision
+	};
+	struct Decision {
+		Clock::time_point time;
+		int fromConsumers;
+		int toConsumers;
+		int depth;
+		double utilisation;
+	};
+private:
+	struct Worker {
+		std::thread thread;
+		int slot;
+		std::atomic<bool> retire;
+		std::atomic<bool> finished;
+		std::atomic<long long> busyNs;
+		std::atomic<long long> processed;
+		// written by worker once, before finished
+		ThreadCpu cpu;
+		bool cpuMeasured = false;
+		Worker(int slot) : slot(slot), retire(false), finished(false), busyNs(0), processed(0) {}
+	};
+	ProduceConsumeStrategy& strategy;
+	IQueue* pQueue;
+	BatchHandler handler;
+	Settings settings;
+	std::vector<std::unique_ptr<Worker>> workers; // retiring ones included
+	std::vector<bool> slotsUsed; // by workers, retiring ones included
+	std::vector<Decision> decisions;
+	mutable std::mutex poolLock;
+	std::thread controller;
+	std::atomic<bool> stop;
+	std::atomic<int> activeConsumers;
+	std::atomic<long long> retiredProcessed;
+	std::atomic<long long> ups;
+	std::atomic<long long> downs;
+	ThreadCpu joinedCpu; // of joined workers, guarded by poolLock
+	int joinedCpuFailures = 0;
+	double lastUtilisation = 0;
+	int lastDepth = 0;
+
+	// false while all slots are held, retiring workers keep theirs until they finish
+	bool addWorker() {
+		auto freeSlot = std::find(slotsUsed.begin(), slotsUsed.end(), false);
+		if (freeSlot == slotsUsed.end()) return false;
+		*freeSlot = true;
+		workers.push_back(std::make_unique<Worker>(static_cast<int>(freeSlot - slotsUsed.begin())));
+		Worker& worker = *workers.back();
+		worker.thread = std::thread([&worker, this]() {
+			ThreadCpu begin;
+			bool begun = ThreadCpu::current(begin);
+			std::vector<int> batch((std::max)(1, settings.batchSize));
+			while (!stop.load() && !worker.retire.load()) {
+				int count = strategy.consumeBulk(batch.data(), static_cast<int>(batch.size()));
+				if (count == 0) break;
+				// taken items are handled even after stop, handler may be waited for by others
+				Clock::time_point handleBegin = Clock::now();
+				handler(worker.slot, batch.data(), count);
+				worker.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - handleBegin).count();
+				worker.processed += count;
+			}
+			ThreadCpu end;
+			if (begun && ThreadCpu::current(end)) {
+				worker.cpu = end - begin;
+				worker.cpuMeasured = true;
+			}
+			worker.finished = true;
+		});
+		++activeConsumers;
+		return true;
+	}
+	// retired worker leaves after handling its current batch
+	void retireWorker() {
+		for (auto it = workers.rbegin(); it != workers.rend(); ++it) {
+			if ((*it)->retire.load()) continue;
+			(*it)->retire = true;
+			--activeConsumers;
+			return;
+		}
+	}
+	void join(Worker& worker) {
+		worker.thread.join();
+		retiredProcessed += worker.processed.load();
+		if (worker.cpuMeasured) joinedCpu += worker.cpu;
+		else ++joinedCpuFailures;
+	}
+	void joinFinished() {
+		for (auto it = workers.begin(); it != workers.end();) {
+			if ((*it)->finished.load()) {
+				join(**it);
+				slotsUsed[(*it)->slot] = false;
+				it = workers.erase(it);
+			}
+			else ++it;
+		}
+	}
+	void control() {
+		int above = 0, below = 0, cooldown = 0;
+		Clock::time_point lastSample = Clock::now();
+		while (!stop.load()) {
+			std::this_thread::sleep_for(settings.interval);
+			std::unique_lock<std::mutex> locker(poolLock);
+			joinFinished();
+			long long busyNs = 0;
+			for (auto& pWorker : workers) busyNs += pWorker->busyNs.exchange(0);
+			Clock::time_point now = Clock::now();
+			long long elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastSample).count();
+			lastSample = now;
+			lastDepth = pQueue->approximateSize();
+			lastUtilisation = elapsedNs > 0
+				? static_cast<double>(busyNs) / (static_cast<double>(elapsedNs) * (std::max)(1, activeConsumers.load()))
+				: 0;
+			above = (lastDepth > settings.highDepth || lastUtilisation > settings.highUtilisation) ? above + 1 : 0;
+			below = (lastDepth < settings.lowDepth && lastUtilisation < settings.lowUtilisation) ? below + 1 : 0;
+			if (cooldown > 0) {
+				--cooldown;
+				continue;
+			}
+			int from = activeConsumers.load();
+			if (above >= settings.upSamples && from < settings.maxConsumers && addWorker()) ++ups;
+			else if (below >= settings.downSamples && from > settings.minConsumers) {
+				retireWorker();
+				++downs;
+			}
+			else continue;
+			decisions.push_back(Decision{ now, from, activeConsumers.load(), lastDepth, lastUtilisation });
+			above = below = 0;
+			cooldown = settings.cooldownSamples;
+		}
+	}
+public:
+	AutoscalingConsumerPool(ProduceConsumeStrategy& strategy, IQueue* pQueue, BatchHandler handler, Settings settings)
+		: strategy(strategy), pQueue(pQueue), handler(handler), settings(settings),
+		slotsUsed(slots(settings), false), stop(false), activeConsumers(0), retiredProcessed(0), ups(0), downs(0) {}
+	// handler is called for each item
+	AutoscalingConsumerPool(ProduceConsumeStrategy& strategy, IQueue* pQueue, Handler handler, Settings settings)
+		: AutoscalingConsumerPool(strategy, pQueue, [handler](int, const int* values, int count) {
+			for (int i = 0; i < count; ++i) handler(values[i]);
+		}, settings) {}
+	AutoscalingConsumerPool(ProduceConsumeStrategy& strategy, IQueue* pQueue, Handler handler)
+		: AutoscalingConsumerPool(strategy, pQueue, handler, Settings()) {}
+	// retiring workers finish their batch while new ones start, so twice the most consumers
+	static int slots(const Settings& settings) { return 2 * (std::max)(1, settings.maxConsumers); }
+	AutoscalingConsumerPool(const AutoscalingConsumerPool&) = delete;
+	AutoscalingConsumerPool& operator=(const AutoscalingConsumerPool&) = delete;
+	void start() {
+		std::unique_lock<std::mutex> locker(poolLock);
+		while (activeConsumers.load() < settings.minConsumers && addWorker());
+		controller = std::thread(&AutoscalingConsumerPool::control, this);
+	}
+	// stops the strategy too, consumers blocked in it have to leave
+	void setStop(bool stop) {
+		if (!stop || this->stop.exchange(true)) return;
+		strategy.setStop(true);
+		if (controller.joinable()) controller.join();
+		std::unique_lock<std::mutex> locker(poolLock);
+		for (auto& pWorker : workers) join(*pWorker);
+		workers.clear();
+	}
+	int consumers() const { return activeConsumers.load(); }
+	int depth() const {
+		std::unique_lock<std::mutex> locker(poolLock);
+		return lastDepth;
+	}
+	double utilisation() const {
+		std::unique_lock<std::mutex> locker(poolLock);
+		return lastUtilisation;
+	}
+	long long processed() const {
+		std::unique_lock<std::mutex> locker(poolLock);
+		long long total = retiredProcessed.load();
+		for (auto& pWorker : workers) total += pWorker->processed.load();
+		return total;
+	}
+	std::vector<Decision> scalingDecisions() const {
+		std::unique_lock<std::mutex> locker(poolLock);
+		return decisions;
+	}
+	// lock free counts of decisions, for monitoring
+	long long scaleUps() const { return ups.load(); }
+	long long scaleDowns() const { return downs.load(); }
+	// cpu of workers that ended, all of them after stop; workers whose cpu was not available are counted
+	ThreadCpu workersCpu() const {
+		std::unique_lock<std::mutex> locker(poolLock);
+		return joinedCpu;
+	}
+	int cpuFailures() const {
+		std::unique_lock<std::mutex> locker(poolLock);
+		return joinedCpuFailures;
+	}
+	~AutoscalingConsumerPool() { setStop(true); }
+};
+
+
+enum class QueueKind { QUEUE, RING, TWO_LOCK, DEADLINE, DELAY };
+enum class StrategyKind { BRUTE_FORCE, SLEEP, WAIT, ADAPTIVE, TWO_LOCK, PAUSE, YIELD, EXPONENTIAL, JITTERED };
+enum class ArrivalProcess { UNIFORM, POISSON, CONSTANT };
+enum class SchedulingPolicy { NORMAL, FIFO, ROUND_ROBIN };
+
+inline const char* policyName(SchedulingPolicy policy) {
+	switch (policy) {
+	case SchedulingPolicy::FIFO: return "fifo";
+	case SchedulingPolicy::ROUND_ROBIN: return "rr";
+	default: return "normal";
+	}
+}
+
+struct TestReport {
+	long long produced = 0;
+	long long consumed = 0;
+	double seconds = 0;
+	long long violations = 0;
+	int pinFailures = 0;
+	// sequenced queue: items released in sequence order after consumers, and largest distance
+	// of a consumed item from the next one to release
+	long long reordered = 0;
+	long long reorderWindow = 0;
+	// deadline queue: items consumed after their deadline, -1 when run had no deadline queue
+	long long missedDeadlines = -1;
+	long long earlyReleases = 0; // delay queue: items consumed before their delay passed
+	// ring queue storage as obtained, huge pages and locking may be refused
+	bool hugePages = false;
+	bool memoryLocked = false;
+	long long waits = 0; // strategy slow path entries
+	long long rejects = 0; // produce attempts that found the queue full
+	long long fullProduced = 0; // items that found the queue full at least once
+	// produce to consume, microseconds
+	double latencyP50 = 0;
+	double latencyP99 = 0;
+	double latencyP999 = 0;
+	// cpu of producer and consumer threads, summed over threads
+	ThreadCpu producersCpu;
+	ThreadCpu consumersCpu;
+	int cpuFailures = 0; // threads whose cpu time was not available
+	// items per second all producers were asked for, -1 when file or trace decides producers' pace
+	double requestedRate = 0;
+	// policy threads run under, NORMAL if any of them could not be switched
+	SchedulingPolicy producersPolicy = SchedulingPolicy::NORMAL;
+	SchedulingPolicy consumersPolicy = SchedulingPolicy::NORMAL;
+	int schedulingFailures = 0;
+	// consumed values written to files
+	long long sinkBytes = 0;
+	long long sinkStalls = 0; // consumer waited for disk
+	int sinkFailures = 0; // files that could not be created or written
+	bool sourceFailed = false; // source file could not be mapped, nothing produced
+	bool traceFailed = false; // trace could not be replayed (nothing produced) or recorded
+	bool configurationFailed = false; // builder settings conflict, nothing ran
+	int consumers = 0; // most running at once when autoscaled
+	// autoscaling pool decisions that added or retired a consumer
+	long long scaleUps = 0;
+	long long scaleDowns = 0;
+	int queueLimit = 0; // 0 is unlimited
+	// service is one consumer cycle: sleep before consumeBulk, which then takes up to batchSize
+	// items at once; time blocked in consumeBulk on an empty queue is not service
+	int batchSize = 1;
+	long long services = 0;
+	double serviceSeconds = 0;
+	double serviceCv2 = 0; // squared coefficient of variation of service time
+	double arrivalRate() const { return seconds > 0 ? produced / seconds : 0; }
+	// batches per second of one consumer while not waiting for items
+	double serviceRate() const { return serviceSeconds > 0 ? services / serviceSeconds : 0; }
+	// share of produced items that found the queue full
+	double fullShare() const { return produced > 0 ? (std::min)(1.0, static_cast<double>(fullProduced) / produced) : 0; }
+	double producedRate() const { return seconds > 0 ? produced / seconds : 0; }
+	double throughput() const { return seconds > 0 ? consumed / seconds : 0; }
+	double cpuNsPerItem() const {
+		return consumed > 0 ? static_cast<double>(producersCpu.cpuNs + consumersCpu.cpuNs) / consumed : 0;
+	}
+};
+
+#if defined(_WIN32) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// waits for deadlines spaced by requested intervals from previous deadline, not from now,
+// so sleep overshoot doesn't add up: sleeps until spin before deadline, then spins;
+// to be created and used by one thread, it lowers timer slack of that thread
+class Pacer {
+public:
+	typedef std::chrono::steady_clock Clock;
+private:
+	std::chrono::nanoseconds spin;
+	Clock::time_point deadline;
+#ifdef _WIN32
+	HANDLE timer = NULL;
+	bool periodRaised = false;
+#endif
+
+	void sleepUntil(Clock::time_point wakeup) {
+		std::chrono::nanoseconds remaining = wakeup - Clock::now();
+		if (remaining.count() <= 0) return;
+#ifdef _WIN32
+		LARGE_INTEGER due;
+		due.QuadPart = -(remaining.count() / 100); // relative, 100 ns units
+		if (timer && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) WaitForSingleObject(timer, INFINITE);
+		else std::this_thread::sleep_until(wakeup);
+#elif defined(__linux__)
+		// absolute, so being preempted before the call doesn't delay wakeup
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long long target = static_cast<long long>(now.tv_sec) * 1000000000 + now.tv_nsec + remaining.count();
+		timespec absolute;
+		absolute.tv_sec = static_cast<time_t>(target / 1000000000);
+		absolute.tv_nsec = static_cast<long>(target % 1000000000);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &absolute, nullptr) == EINTR) {}
+#else
+		std::this_thread::sleep_until(wakeup);
+#endif
+	}
+public:
+	explicit Pacer(std::chrono::nanoseconds spin = std::chrono::microseconds(50))
+		: spin(spin), deadline(Clock::now()) {
+#ifdef _WIN32
+		// high resolution timer since Windows 10 1803, otherwise 1 ms system timer
+		timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!timer) {
+			timer = CreateWaitableTimerW(NULL, TRUE, NULL);
+			periodRaised = timeBeginPeriod(1) == TIMERR_NOERROR;
+		}
+#elif defined(__linux__)
+		// default 50 us slack would be added to every sleep
+		prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+	}
+	Pacer(const Pacer&) = delete;
+	Pacer& operator=(const Pacer&) = delete;
+	~Pacer() {
+#ifdef _WIN32
+		if (timer) CloseHandle(timer);
+		if (periodRaised) timeEndPeriod(1);
+#endif
+	}
+	// a late caller is not waited for until schedule is caught up
+	void wait(std::chrono::nanoseconds interval) {
+		deadline += interval;
+		Clock::time_point wakeup = deadline - spin;
+		if (Clock::now() < wakeup) sleepUntil(wakeup);
+		while (Clock::now() < deadline) cpuRelax();
+	}
+	// schedule starts over from now
+	void reset() { deadline = Clock::now(); }
+};
+
+// false if the cpu doesn't exist or is not permitted
+inline bool pinThread(std::thread& thread, int cpu) {
+#ifdef _WIN32
+	if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) return false;
+	return SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#else
+	if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#endif
+}
+
+// false if policy or priority is not permitted, usually missing CAP_SYS_NICE;
+// Windows has no real-time policies for threads, FIFO is mapped to time critical
+// and ROUND_ROBIN to highest thread priority, priority itself is ignored
+inline bool scheduleThread(std::thread& thread, SchedulingPolicy policy, int priority) {
+#ifdef _WIN32
+	int windowsPriority = THREAD_PRIORITY_NORMAL;
+	if (policy == SchedulingPolicy::FIFO) windowsPriority = THREAD_PRIORITY_TIME_CRITICAL;
+	else if (policy == SchedulingPolicy::ROUND_ROBIN) windowsPriority = THREAD_PRIORITY_HIGHEST;
+	return SetThreadPriority(thread.native_handle(), windowsPriority) != 0;
+#else
+	int posixPolicy = SCHED_OTHER;
+	if (policy == SchedulingPolicy::FIFO) posixPolicy = SCHED_FIFO;
+	else if (policy == SchedulingPolicy::ROUND_ROBIN) posixPolicy = SCHED_RR;
+	sched_param parameters;
+	parameters.sched_priority = policy == SchedulingPolicy::NORMAL ? 0 : priority;
+	return pthread_setschedparam(thread.native_handle(), posixPolicy, &parameters) == 0;
+#endif
+}
+
+class ProducerConsumerTester {
+	friend class ProducerConsumerTesterBuilder;
+	friend class ProducerConsumerSimulation;
+private:
+	// heap allocated, strategy keeps pointer while tester is moved;
+	// each wraps the previous one, strategy uses the last
+	std::vector<std::unique_ptr<IQueue>> queues;
+	std::unique_ptr<ProduceConsumeStrategy> strategy = nullptr;
+	int producersCount = 1;
+	int consumersCount = 1;
+	ArrivalProcess arrival = ArrivalProcess::UNIFORM;
+	int producerSleepTime = 100;
+	bool precisePacing = false; // Pacer instead of sleep_for between produced items
+	std::chrono::microseconds pacingSpin = std::chrono::microseconds(50);
+	int consumerSleepTime = 100;
+	int consumeBatchSize = 64;
+	std::string sinkPath; // consumed values written here when not empty
+	std::string sourcePath; // values produced from this file instead of counter when not empty
+	int produceBatchSize = 64; // for source
+	std::string recordPath; // producers intervals saved here as ArrivalTrace when not empty
+	std::string replayPath; // producers intervals taken from this ArrivalTrace when not empty
+	std::chrono::milliseconds duration = std::chrono::seconds(10);
+	std::vector<int> cpus; // threads are pinned round robin, producers first
+	SchedulingPolicy producersPolicy = SchedulingPolicy::NORMAL;
+	SchedulingPolicy consumersPolicy = SchedulingPolicy::NORMAL;
+	int producersPriority = 1;
+	int consumersPriority = 1;
+	std::ostream* statsOut = nullptr; // live stats when set
+	std::chrono::milliseconds statsInterval = std::chrono::seconds(1);
+	std::string metricsPath; // Prometheus metrics file when not empty
+	std::string metricsLabels;
+	std::chrono::milliseconds metricsInterval = std::chrono::seconds(5);
+	std::ostream* depthOut = nullptr; // depth series written at the end when set
+	std::chrono::microseconds depthInterval = std::chrono::milliseconds(1);
+	int depthSamples = 10000;
+	int queueLimit = 0; // items queue holds at most, 0 is unlimited
+	bool sequenced = false; // last queue is SequencedQueue, consumers release items through ReorderBuffer
+	DeadlineQueue* deadlineQueue = nullptr; // first of queues when deadline queue is tested
+	DelayQueue* delayQueue = nullptr; // first of queues when delay queue is tested
+	RingQueue* ringQueue = nullptr; // first of queues when ring queue is tested
+	std::chrono::microseconds deadlineSpread = std::chrono::microseconds(0); // random extra deadline per item
+	// consumers are workers of AutoscalingConsumerPool instead of consumersCount threads
+	bool autoscaling = false;
+	AutoscalingConsumerPool::Settings autoscaleSettings;
+	TestReport report;
+
+	// produce time by value, values further apart than STAMPS overwrite each other
+	static const int STAMPS = 1 << 20;
+	static long long now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static std::chrono::microseconds sleepTime(std::mt19937& random, ArrivalProcess arrival, int sleepTime) {
+		switch (arrival) {
+		case ArrivalProcess::POISSON:
+			return std::chrono::microseconds(static_cast<long long>(
+				std::exponential_distribution<double>(1.0 / sleepTime)(random)));
+		case ArrivalProcess::CONSTANT:
+			return std::chrono::microseconds(sleepTime);
+		default:
+			return std::chrono::microseconds(sleepTime / 2 + random() % sleepTime);
+		}
+	}
+public:
+	ProducerConsumerTester() = default;
+	ProducerConsumerTester(const ProducerConsumerTester&) = delete;
+	ProducerConsumerTester& operator=(const ProducerConsumerTester&) = delete;
+	ProducerConsumerTester(ProducerConsumerTester&&) = default;
+	ProducerConsumerTester& operator=(ProducerConsumerTester&&) = default;
+
+	TestReport test() {
+		report = TestReport{};
+		if (!strategy) {
+			report.configurationFailed = true;
+			return report;
+		}
+
+		ArrivalTrace replayed;
+		if (!replayPath.empty()) {
+			if (!replayed.load(replayPath) || replayed.streams.empty()) {
+				report.traceFailed = true;
+				return report;
+			}
+			// trace decides producers, each replays own stream and stops at its end
+			producersCount = static_cast<int>(replayed.streams.size());
+		}
+
+		std::atomic<bool> stop(false);
+		std::atomic<int> counterProducer(0);
+		std::atomic<int> producersEnded(0); // before stop, at end of their input
+		// pool workers take slots, one running worker per slot; pool threads are not the tester's,
+		// so they are not pinned or scheduled, pool measures their cpu
+		const int consumerSlots = autoscaling ? AutoscalingConsumerPool::slots(autoscaleSettings) : consumersCount;
+		const int consumerThreads = autoscaling ? 0 : consumersCount;
+		// one counter and histogram per consumer, data path never shares a cache line
+		std::vector<ThreadCounter> produced(producersCount);
+		std::vector<ThreadCounter> consumed(consumerSlots);
+		std::vector<LatencyHistogram> latencies(consumerSlots);
+		// one file per consumer, numbered when more than one
+		std::vector<std::unique_ptr<FileSink>> sinks(consumerSlots);
+		for (int i = 0; i < consumerSlots && !sinkPath.empty(); ++i) {
+			sinks[i] = std::make_unique<FileSink>();
+			if (sinks[i]->open(consumerSlots == 1 ? sinkPath : sinkPath + "." + std::to_string(i))) continue;
+			sinks[i].reset();
+			++report.sinkFailures;
+		}
+		std::unique_ptr<std::atomic<long long>[]> producedAt(new std::atomic<long long>[STAMPS]);
+		std::atomic<long long> violations(0);
+		std::atomic<long long> earlyReleases(0);
+		// written by each thread once, when it ends
+		std::vector<ThreadCpu> cpu(producersCount + consumerThreads);
+		std::vector<char> cpuMeasured(producersCount + consumerThreads, 0);
+		// count, sum and sum of squares of service times, written by each consumer when it ends
+		std::vector<long long> services(consumerSlots, 0);
+		std::vector<double> serviceSums(consumerSlots, 0), serviceSquares(consumerSlots, 0);
+		auto measure = [&](int thread, const ThreadCpu& begin, bool begun) {
+			ThreadCpu end;
+			if (!begun || !ThreadCpu::current(end)) return;
+			cpu[thread] = end - begin;
+			cpuMeasured[thread] = 1;
+		};
+		ArrivalTrace recorded;
+		if (!recordPath.empty()) recorded.streams.resize(producersCount);
+		std::unique_ptr<FileSource> source;
+		if (!sourcePath.empty()) {
+			source = std::make_unique<FileSource>();
+			if (!source->open(sourcePath)) {
+				report.sourceFailed = true;
+				return report;
+			}
+		}
+		// order is known only with one producer and one consumer, spread deadlines reorder items
+		// and timing wheel of delay queue may swap items due in the same tick
+		const bool checkOrder = producersCount == 1 && consumersCount == 1 && !autoscaling
+			&& !(deadlineQueue && deadlineSpread.count() > 0) && !delayQueue;
+		const long long minimumDelay = delayQueue ? delayQueue->delay().count() : 0;
+		// items come out of it in sequence order, which is produced order with one producer
+		std::unique_ptr<ReorderBuffer> reorder;
+		long long releasedCount = 0; // guarded by reorder buffer
+		if (sequenced) {
+			reorder = std::make_unique<ReorderBuffer>(2 * consumerSlots * consumeBatchSize, [&](int value) {
+				long long index = releasedCount++;
+				if (producersCount != 1) return;
+				if (source ? index < static_cast<long long>(source->count()) && value != source->data()[index]
+					: value != static_cast<int>(index)) ++violations;
+			});
+		}
+		std::random_device seeds;
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < producersCount; ++i) {
+			threads.emplace_back([&, i, seed = seeds()](const ProduceConsumeStrategy& pc) {
+				std::mt19937 random(seed);
+				ThreadCpu begin;
+				bool begun = ThreadCpu::current(begin);
+				if (source) {
+					// recorded data at full speed, producer ends with file
+					const int* values = nullptr;
+					int count = 0;
+					while (!stop.load() && (count = source->next(values, produceBatchSize)) > 0) {
+						int producedCount = pc.produceBulk(values, count);
+						if (!stop.load()) produced[i].add(producedCount);
+					}
+					if (!stop.load()) ++producersEnded;
+					measure(i, begin, begun);
+					return;
+				}
+				const std::vector<long long>* replay = replayPath.empty() ? nullptr : &replayed.streams[i];
+				std::vector<long long>* record = recordPath.empty() ? nullptr : &recorded.streams[i];
+				std::unique_ptr<Pacer> pacer;
+				// recorded intervals already hold sleep overshoot, replay keeps their absolute schedule
+				if (precisePacing || replay) pacer = std::make_unique<Pacer>(pacingSpin);
+				size_t arrivals = 0;
+				long long lastArrival = now();
+				while (!stop.load()) {
+					std::chrono::nanoseconds pause;
+					if (replay) {
+						if (arrivals == replay->size()) {
+							++producersEnded;
+							break;
+						}
+						pause = std::chrono::nanoseconds((*replay)[arrivals++]);
+					}
+					else pause = sleepTime(random, arrival, producerSleepTime);
+					if (pacer) pacer->wait(pause);
+					else std::this_thread::sleep_for(pause);
+					if (deadlineQueue && deadlineSpread.count() > 0) {
+						// queue's relative deadline plus up to spread
+						DeadlineQueue::setNextDeadline(DeadlineQueue::Clock::now() + deadlineQueue->deadline()
+							+ std::chrono::microseconds(random() % deadlineSpread.count()));
+					}
+					int value = counterProducer++;
+					long long arrivedAt = now();
+					producedAt[value & (STAMPS - 1)].store(arrivedAt, std::memory_order_relaxed);
+					// interval the producer actually waited, as trace promises
+					if (record) record->push_back(arrivedAt - lastArrival);
+					lastArrival = arrivedAt;
+					pc.produce(value);
+					if (!stop.load()) produced[i].add(1);
+				}
+				measure(i, begin, begun);
+			}, std::ref(*(strategy.get()))); // pattern: bridge
+		}
+		// after consumeBulk of consumer i, returns when consumed
+		auto handle = [&](int i, const int* batch, int consumedCount) {
+			consumed[i].add(consumedCount);
+			if (reorder) {
+				// left by consumeBulk of this thread
+				const std::vector<long long>& sequences = SequencedQueue::lastSequences();
+				assert(static_cast<int>(sequences.size()) == consumedCount);
+				for (int j = 0; j < consumedCount && j < static_cast<int>(sequences.size()); ++j) {
+					reorder->submit(sequences[j], batch[j]);
+				}
+			}
+			if (sinks[i]) sinks[i]->write(batch, consumedCount);
+			// one clock read per batch; recorded values repeat, they can't be stamped
+			long long consumedAt = now();
+			for (int j = 0; j < consumedCount && !source; ++j) {
+				long long latency = consumedAt - producedAt[batch[j] & (STAMPS - 1)].load(std::memory_order_relaxed);
+				latencies[i].record(latency);
+				// stamp is taken before produce, so an item released early by less than that gap passes
+				if (latency < minimumDelay) ++earlyReleases;
+			}
+			return consumedAt;
+		};
+		auto addService = [&](int i, double service) {
+			++services[i];
+			serviceSums[i] += service;
+			serviceSquares[i] += service * service;
+		};
+		for (int i = 0; i < consumerThreads; ++i) {
+			threads.emplace_back([&, i, seed = seeds()](const ProduceConsumeStrategy& pc) {
+				std::mt19937 random(seed);
+				std::vector<int> batch(consumeBatchSize);
+				int counterConsumer = 0;
+				ThreadCpu begin;
+				bool begun = ThreadCpu::current(begin);
+				long long serviceStart = now();
+				while (!stop.load()) {
+					std::this_thread::sleep_for(sleepTime(random, ArrivalProcess::UNIFORM, consumerSleepTime));
+					double service = (now() - serviceStart) / 1e9;
+					int consumedCount = pc.consumeBulk(batch.data(), consumeBatchSize);
+					if (stop.load()) break;
+					addService(i, service);
+					serviceStart = handle(i, batch.data(), consumedCount);
+					if (!checkOrder) continue;
+					// whole batch at once, instead of one check per item
+					int valid = source
+						? static_cast<int>(std::mismatch(batch.data(), batch.data() + consumedCount,
+							source->data() + counterConsumer).first - batch.data())
+						: sequenceBreak(batch.data(), consumedCount, counterConsumer);
+					assert(valid == consumedCount);
+					if (valid != consumedCount) ++violations;
+					counterConsumer += consumedCount;
+				}
+				measure(producersCount + i, begin, begun);
+			}, std::ref(*(strategy.get()))); // pattern: bridge
+		}
+		if (!cpus.empty()) {
+			for (size_t i = 0; i < threads.size(); ++i) {
+				if (!pinThread(threads[i], cpus[i % cpus.size()])) ++report.pinFailures;
+			}
+		}
+		report.producersPolicy = producersPolicy;
+		report.consumersPolicy = consumersPolicy;
+		for (int i = 0; i < producersCount + consumerThreads; ++i) {
+			bool producer = i < producersCount;
+			SchedulingPolicy policy = producer ? producersPolicy : consumersPolicy;
+			if (policy == SchedulingPolicy::NORMAL) continue;
+			if (scheduleThread(threads[i], policy, producer ? producersPriority : consumersPriority)) continue;
+			// test goes on, report shows threads were not real-time
+			++report.schedulingFailures;
+			(producer ? report.producersPolicy : report.consumersPolicy) = SchedulingPolicy::NORMAL;
+		}
+
+		auto sum = [](const std::vector<ThreadCounter>& counters) {
+			long long total = 0;
+			for (const ThreadCounter& counter : counters) total += counter.load();
+			return total;
+		};
+		auto collect = [&](LatencyHistogram::Snapshot& snapshot) {
+			long long total = 0;
+			for (const LatencyHistogram& histogram : latencies) {
+				histogram.addTo(snapshot);
+				total += histogram.sum();
+			}
+			return total;
+		};
+		IQueue* pQueue = queues.back().get();
+		ProduceConsumeStrategy* pStrategy = strategy.get();
+		std::unique_ptr<AutoscalingConsumerPool> pool;
+		if (autoscaling) {
+			// consumer cycle as for threads, but work after consumeBulk: the pool measures
+			// utilisation as time in handler
+			std::vector<std::mt19937> randoms;
+			for (int i = 0; i < consumerSlots; ++i) randoms.emplace_back(seeds());
+			AutoscalingConsumerPool::Settings settings = autoscaleSettings;
+			settings.batchSize = consumeBatchSize;
+			pool = std::make_unique<AutoscalingConsumerPool>(*strategy, pQueue,
+				[&, randoms](int slot, const int* batch, int count) mutable {
+					// batch taken at stop is still released, workers behind it in reorder buffer wait for it
+					handle(slot, batch, count);
+					if (stop.load()) return;
+					long long serviceStart = now();
+					std::this_thread::sleep_for(sleepTime(randoms[slot], ArrivalProcess::UNIFORM, consumerSleepTime));
+					addService(slot, (now() - serviceStart) / 1e9);
+				}, settings);
+		}
+		AutoscalingConsumerPool* pPool = pool.get();
+		std::function<long long()> scaleUps, scaleDowns; // empty without pool
+		if (pPool) {
+			scaleUps = [pPool]() { return pPool->scaleUps(); };
+			scaleDowns = [pPool]() { return pPool->scaleDowns(); };
+		}
+		const int fixedConsumers = consumersCount;
+		StatsSources sources{
+			[&]() { return sum(produced); },
+			[&]() { return sum(consumed); },
+			[pQueue]() { return pQueue->approximateSize(); },
+			[pStrategy]() { return pStrategy->waitsCount(); },
+			[pStrategy]() { return pStrategy->rejectsCount(); },
+			collect,
+			[pPool, fixedConsumers]() { return pPool ? pPool->consumers() : fixedConsumers; },
+			scaleUps,
+			scaleDowns
+		};
+		std::unique_ptr<StatsReporter> reporter;
+		if (statsOut) {
+			reporter = std::make_unique<StatsReporter>(sources, *statsOut, statsInterval);
+			reporter->start();
+		}
+		std::unique_ptr<PrometheusExporter> exporter;
+		if (!metricsPath.empty()) {
+			exporter = std::make_unique<PrometheusExporter>(sources, metricsPath, metricsLabels, metricsInterval);
+			exporter->start();
+		}
+		std::unique_ptr<DepthSampler> sampler;
+		if (depthOut) {
+			sampler = std::make_unique<DepthSampler>(sources, queueLimit, depthInterval, depthSamples);
+			sampler->start();
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (pool) pool->start();
+		if (!source && replayPath.empty()) std::this_thread::sleep_for(duration);
+		else {
+			// producers end with the file or trace, the run ends when they all did and the queue is drained,
+			// so seconds and rates are of the work, not of the idle tail
+			while (std::chrono::steady_clock::now() - start < duration) {
+				if (producersEnded.load() == producersCount && sum(consumed) >= sum(produced)) break;
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		stop.store(true);
+		strategy->setStop(true);
+		// workers blocked in reorder buffer leave before pool joins them
+		if (reorder) reorder->setStop(true);
+		if (pool) pool->setStop(true);
+		if (reporter) reporter->setStop(true);
+		if (sampler) sampler->setStop(true);
+
+		for (std::thread& thread : threads) thread.join();
+		if (exporter) exporter->setStop(true);
+		if (sampler) sampler->write(*depthOut);
+
+		report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		report.produced = sum(produced);
+		report.consumed = sum(consumed);
+		report.violations = violations.load();
+		if (reorder) {
+			report.reordered = reorder->released();
+			report.reorderWindow = reorder->window();
+		}
+		if (deadlineQueue) report.missedDeadlines = deadlineQueue->missed();
+		report.earlyReleases = earlyReleases.load();
+		if (ringQueue) {
+			report.hugePages = ringQueue->storage().hugePages();
+			report.memoryLocked = ringQueue->storage().locked();
+		}
+		if (!recordPath.empty() && !recorded.save(recordPath)) report.traceFailed = true;
+		for (std::unique_ptr<FileSink>& sink : sinks) {
+			if (!sink) continue;
+			sink->close();
+			report.sinkBytes += sink->written();
+			report.sinkStalls += sink->stalls();
+			if (sink->failed()) ++report.sinkFailures;
+		}
+		report.waits = strategy->waitsCount();
+		report.rejects = strategy->rejectsCount();
+		report.fullProduced = strategy->fullCount();
+		report.consumers = consumersCount;
+		if (pool) {
+			report.consumers = autoscaleSettings.minConsumers;
+			for (const AutoscalingConsumerPool::Decision& decision : pool->scalingDecisions()) {
+				report.consumers = (std::max)(report.consumers, decision.toConsumers);
+			}
+			report.scaleUps = pool->scaleUps();
+			report.scaleDowns = pool->scaleDowns();
+		}
+		report.batchSize = consumeBatchSize;
+		report.queueLimit = queueLimit;
+		double serviceSquaresTotal = 0;
+		for (int i = 0; i < consumerSlots; ++i) {
+			report.services += services[i];
+			report.serviceSeconds += serviceSums[i];
+			serviceSquaresTotal += serviceSquares[i];
+		}
+		if (report.services > 0 && report.serviceSeconds > 0) {
+			double mean = report.serviceSeconds / report.services;
+			report.serviceCv2 = (std::max)(0.0, serviceSquaresTotal / report.services / (mean * mean) - 1);
+		}
+		// mean interval of every arrival process is producerSleepTime
+		report.requestedRate = source || !replayPath.empty() ? -1 : producersCount * 1e6 / producerSleepTime;
+		for (int i = 0; i < producersCount + consumerThreads; ++i) {
+			if (!cpuMeasured[i]) ++report.cpuFailures;
+			else if (i < producersCount) report.producersCpu += cpu[i];
+			else report.consumersCpu += cpu[i];
+		}
+		if (pool) {
+			report.consumersCpu += pool->workersCpu();
+			report.cpuFailures += pool->cpuFailures();
+		}
+		LatencyHistogram::Snapshot snapshot;
+		collect(snapshot);
+		report.latencyP50 = LatencyHistogram::percentile(snapshot, 0.5) / 1000.0;
+		report.latencyP99 = LatencyHistogram::percentile(snapshot, 0.99) / 1000.0;
+		report.latencyP999 = LatencyHistogram::percentile(snapshot, 0.999) / 1000.0;
+		return report;
+	}
+	// consumed batches that broke produced order
+	long long violations() const { return report.violations; }
+	const TestReport& lastReport() const { return report; }
+};
+
+struct SimulationReport {
+	long long produced = 0;
+	long long consumed = 0;
+	double seconds = 0; // virtual
+	long long rejects = 0; // produce attempts that found the queue full
+	long long fullProduced = 0; // items that found the queue full at least once
+	int maxDepth = 0;
+	double meanDepth = 0; // time weighted
+	// produce to consume, microseconds
+	double latencyP50 = 0;
+	double latencyP99 = 0;
+	double latencyP999 = 0;
+	long long events = 0;
+	double throughput() const { return seconds > 0 ? consumed / seconds : 0; }
+};
+
+// discrete-event model of test() in virtual time, runs in milliseconds instead of duration:
+// same arrival processes, consumer sleep times, batches and queue limit; every sleep is late
+// by sleepOvershoot, as sleep_for is; every strategy overrides consumeBulk, so a consumer takes
+// up to its batch of what is queued when it runs; strategies differ only in how a thread waiting
+// for full or empty queue notices change:
+// SLEEP polls every 100 us, spinning strategies notice at once, blocking ones after wakeLatency;
+// produce and consume themselves take no time and threads never wait for a cpu;
+// file source and sink, trace replay, precise pacing and sequencing are not modelled
+class ProducerConsumerSimulation {
+	friend class ProducerConsumerTesterBuilder;
+private:
+	typedef long long Time; // nanoseconds
+	enum class Wake { POLL, SPIN, BLOCK };
+	struct Event {
+		Time time;
+		int thread;
+		bool operator>(const Event& other) const {
+			return time != other.time ? time > other.time : thread > other.thread;
+		}
+	};
+	StrategyKind strategyKind = StrategyKind::SLEEP;
+	int producersCount = 1;
+	int consumersCount = 1;
+	ArrivalProcess arrival = ArrivalProcess::UNIFORM;
+	int producerSleepTime = 100;
+	int consumerSleepTime = 100;
+	int consumeBatchSize = 64;
+	std::chrono::milliseconds duration = std::chrono::seconds(10);
+	int queueLimit = 0; // 0 is unlimited
+	unsigned seed = 1;
+	std::chrono::nanoseconds wakeLatency = std::chrono::microseconds(5);
+	std::chrono::nanoseconds sleepOvershoot = std::chrono::nanoseconds(0);
+	std::chrono::nanoseconds pollTime = std::chrono::microseconds(100);
+
+	Wake wake() const {
+		switch (strategyKind) {
+		case StrategyKind::SLEEP: return Wake::POLL;
+		case StrategyKind::WAIT:
+		case StrategyKind::ADAPTIVE:
+		case StrategyKind::TWO_LOCK: return Wake::BLOCK;
+		default: return Wake::SPIN;
+		}
+	}
+public:
+	// same seed gives same run
+	void setSeed(unsigned seed) { this->seed = seed; }
+	// from notify to blocked thread running again
+	void setWakeLatency(std::chrono::nanoseconds wakeLatency) { this->wakeLatency = wakeLatency; }
+	// added to every sleep, real sleep_for wakes late by timer slack and scheduling
+	void setSleepOvershoot(std::chrono::nanoseconds sleepOvershoot) { this->sleepOvershoot = sleepOvershoot; }
+	// mean lateness of sleep_for(sleepTime) on this machine, for setSleepOvershoot
+	static std::chrono::nanoseconds measureSleepOvershoot(std::chrono::microseconds sleepTime, int samples = 100) {
+		std::chrono::steady_clock::duration late(0);
+		for (int i = 0; i < samples; ++i) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::this_thread::sleep_for(sleepTime);
+			late += std::chrono::steady_clock::now() - start - sleepTime;
+		}
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(late / (std::max)(samples, 1));
+	}
+	// measureSleepOvershoot over about 50 ms, at least 10 sleeps, once per process and sleep time
+	static std::chrono::nanoseconds calibratedSleepOvershoot(std::chrono::microseconds sleepTime) {
+		static std::mutex cacheLock;
+		static std::map<long long, std::chrono::nanoseconds> cache;
+		std::unique_lock<std::mutex> locker(cacheLock);
+		auto cached = cache.find(sleepTime.count());
+		if (cached != cache.end()) return cached->second;
+		long long micros = (std::max)(1LL, static_cast<long long>(sleepTime.count()));
+		int samples = static_cast<int>((std::max)(10LL, (std::min)(100LL, 50000 / micros)));
+		return cache[sleepTime.count()] = measureSleepOvershoot(sleepTime, samples);
+	}
+
+	SimulationReport run() const {
+		SimulationReport report;
+		const Time end = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+		const int threadsCount = producersCount + consumersCount;
+		const Wake waking = wake();
+		std::vector<std::mt19937> randoms;
+		for (int i = 0; i < threadsCount; ++i) randoms.emplace_back(seed + i);
+		auto sleep = [&](int thread) {
+			bool producer = thread < producersCount;
+			std::chrono::microseconds pause = ProducerConsumerTester::sleepTime(randoms[thread],
+				producer ? arrival : ArrivalProcess::UNIFORM, producer ? producerSleepTime : consumerSleepTime);
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(pause + sleepOvershoot).count();
+		};
+
+		std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+		std::deque<Time> queued; // produce times, FIFO
+		std::deque<int> waitingProducers, waitingConsumers; // blocked or spinning
+		std::vector<char> producerFull(producersCount, 0); // current item was rejected
+		LatencyHistogram latencies;
+		Time lastChange = 0;
+		double depthTime = 0;
+		for (int i = 0; i < threadsCount; ++i) events.push(Event{ sleep(i), i });
+
+		auto notify = [&](std::deque<int>& waiting, long long count, Time now) {
+			Time delay = waking == Wake::BLOCK ? wakeLatency.count() : 0;
+			for (; count > 0 && !waiting.empty(); --count) {
+				events.push(Event{ now + delay, waiting.front() });
+				waiting.pop_front();
+			}
+		};
+		auto wait = [&](std::deque<int>& waiting, int thread, Time now) {
+			if (waking == Wake::POLL) events.push(Event{ now + pollTime.count() + sleepOvershoot.count(), thread });
+			else waiting.push_back(thread);
+		};
+
+		while (!events.empty() && events.top().time < end) {
+			Event event = events.top();
+			events.pop();
+			++report.events;
+			Time now = event.time;
+			depthTime += static_cast<double>(queued.size()) * (now - lastChange);
+			lastChange = now;
+			if (event.thread < producersCount) {
+				if (queueLimit > 0 && static_cast<int>(queued.size()) >= queueLimit) {
+					++report.rejects;
+					if (!producerFull[event.thread]) ++report.fullProduced;
+					producerFull[event.thread] = 1;
+					wait(waitingProducers, event.thread, now);
+					continue;
+				}
+				queued.push_back(now);
+				producerFull[event.thread] = 0;
+				++report.produced;
+				report.maxDepth = (std::max)(report.maxDepth, static_cast<int>(queued.size()));
+				notify(waitingConsumers, 1, now);
+			}
+			else {
+				if (queued.empty()) {
+					wait(waitingConsumers, event.thread, now);
+					continue;
+				}
+				int batch = (std::min)(consumeBatchSize, static_cast<int>(queued.size()));
+				for (int i = 0; i < batch; ++i) {
+					latencies.record(now - queued.front());
+					queued.pop_front();
+				}
+				report.consumed += batch;
+				notify(waitingProducers, batch, now);
+			}
+			events.push(Event{ now + sleep(event.thread), event.thread });
+		}
+		depthTime += static_cast<double>(queued.size()) * (end - lastChange);
+
+		report.seconds = std::chrono::duration<double>(duration).count();
+		report.meanDepth = end > 0 ? depthTime / end : 0;
+		LatencyHistogram::Snapshot snapshot;
+		latencies.addTo(snapshot);
+		report.latencyP50 = LatencyHistogram::percentile(snapshot, 0.5) / 1000.0;
+		report.latencyP99 = LatencyHistogram::percentile(snapshot, 0.99) / 1000.0;
+		report.latencyP999 = LatencyHistogram::percentile(snapshot, 0.999) / 1000.0;
+		return report;
+	}
+};
+
+// pattern: builder
+class ProducerConsumerTesterBuilder {
+	ProducerConsumerTester builded;
+	QueueKind queueKind = QueueKind::QUEUE;
+	int queueCapacity = 1024; // for ring queue
+	RingMemory::Options ringOptions; // for ring queue
+	std::chrono::microseconds deadline = std::chrono::milliseconds(1); // for deadline queue
+	// for delay queue
+	std::chrono::microseconds delay = std::chrono::milliseconds(1);
+	std::chrono::microseconds delayResolution = std::chrono::milliseconds(1);
+	int maxSize = 0; // SizeLimitedQueue when > 0
+	bool sequenced = false;
+	StrategyKind strategyKind = StrategyKind::SLEEP;
+	// for simulation only
+	unsigned simulationSeed = 1;
+	std::chrono::nanoseconds wakeLatency = std::chrono::microseconds(5);
+	std::chrono::nanoseconds sleepOvershoot = std::chrono::nanoseconds(0); // negative is measured
+
+	// items queue will hold at most, 0 is unlimited
+	int queueLimit() const {
+		if (strategyKind == StrategyKind::TWO_LOCK) return maxSize;
+		int limit = queueKind == QueueKind::RING ? static_cast<int>(RingQueue::capacityFor(queueCapacity)) : 0;
+		if (maxSize > 0) limit = limit > 0 ? (std::min)(limit, maxSize) : maxSize;
+		return limit;
+	}
+	void makeQueues() {
+		builded.queueLimit = queueLimit();
+		builded.sequenced = sequenced && strategyKind != StrategyKind::TWO_LOCK
+			&& queueKind != QueueKind::DEADLINE && queueKind != QueueKind::DELAY;
+		builded.deadlineQueue = nullptr;
+		builded.delayQueue = nullptr;
+		builded.ringQueue = nullptr;
+		std::vector<std::unique_ptr<IQueue>>& queues = builded.queues;
+		queues.clear();
+		if (strategyKind == StrategyKind::TWO_LOCK) {
+			// decorators are not thread safe, limit goes to queue itself
+			queues.push_back(std::make_unique<TwoLockQueue>(maxSize));
+			return;
+		}
+		switch (queueKind) {
+		case QueueKind::RING:
+			queues.push_back(std::make_unique<RingQueue>(queueCapacity, ringOptions));
+			builded.ringQueue = static_cast<RingQueue*>(queues.back().get());
+			break;
+		case QueueKind::TWO_LOCK:
+			queues.push_back(std::make_unique<TwoLockQueue>());
+			break;
+		case QueueKind::DEADLINE:
+			queues.push_back(std::make_unique<DeadlineQueue>(deadline));
+			builded.deadlineQueue = static_cast<DeadlineQueue*>(queues.back().get());
+			break;
+		case QueueKind::DELAY:
+			queues.push_back(std::make_unique<DelayQueue>(delay, delayResolution));
+			builded.delayQueue = static_cast<DelayQueue*>(queues.back().get());
+			break;
+		default:
+			queues.push_back(std::make_unique<Queue>());
+			queues.push_back(std::make_unique<SafeQueue>(queues.back().get()));
+			break;
+		}
+		if (maxSize > 0) queues.push_back(std::make_unique<SizeLimitedQueue>(queues.back().get(), maxSize));
+		if (builded.sequenced) queues.push_back(std::make_unique<SequencedQueue>(queues.back().get()));
+	}
+	void makeStrategy() {
+		IQueue* pQueue = builded.queues.back().get();
+		switch (strategyKind) {
+		case StrategyKind::BRUTE_FORCE:
+			builded.strategy = std::make_unique<BruteForceProduceConsume>(pQueue);
+			break;
+		case StrategyKind::WAIT:
+			builded.strategy = std::make_unique<WaitProduceConsume>(pQueue);
+			break;
+		case StrategyKind::ADAPTIVE:
+			builded.strategy = std::make_unique<AdaptiveProduceConsume>(pQueue);
+			break;
+		case StrategyKind::TWO_LOCK:
+			builded.strategy = std::make_unique<TwoLockProduceConsume>(static_cast<TwoLockQueue*>(pQueue));
+			break;
+		case StrategyKind::PAUSE:
+			builded.strategy = std::make_unique<BackoffProduceConsume<PauseBackoff>>(pQueue);
+			break;
+		case StrategyKind::YIELD:
+			builded.strategy = std::make_unique<BackoffProduceConsume<YieldBackoff>>(pQueue);
+			break;
+		case StrategyKind::EXPONENTIAL:
+			builded.strategy = std::make_unique<BackoffProduceConsume<ExponentialBackoff<>>>(pQueue);
+			break;
+		case StrategyKind::JITTERED:
+			builded.strategy = std::make_unique<BackoffProduceConsume<JitteredBackoff<>>>(pQueue);
+			break;
+		default:
+			builded.strategy = std::make_unique<BackoffProduceConsume<SleepBackoff<100>>>(pQueue);
+			break;
+		}
+	}
+public:
+	// empty when settings go together, otherwise the conflict; strategy TWO_LOCK brings its own
+	// queue, so a chosen queue or its options would be dropped without a word
+	std::string conflict() const {
+		if (strategyKind != StrategyKind::TWO_LOCK) return std::string();
+		if (queueKind == QueueKind::DEADLINE) {
+			return "strategy twolock runs its own queue, deadlines would not be kept nor counted";
+		}
+		if (queueKind == QueueKind::RING || queueKind == QueueKind::DELAY) {
+			return "strategy twolock runs its own queue, it can't use a ring or delay queue";
+		}
+		if (ringOptions.hugePages || ringOptions.lock) return "strategy twolock runs its own queue, ring options don't apply";
+		return std::string();
+	}
+	// model of what build() would test, nothing is created
+	ProducerConsumerSimulation buildSimulation() const {
+		ProducerConsumerSimulation simulation;
+		simulation.strategyKind = strategyKind;
+		simulation.producersCount = builded.producersCount;
+		simulation.consumersCount = builded.consumersCount;
+		simulation.arrival = builded.arrival;
+		simulation.producerSleepTime = builded.producerSleepTime;
+		simulation.consumerSleepTime = builded.consumerSleepTime;
+		simulation.consumeBatchSize = builded.consumeBatchSize;
+		simulation.duration = builded.duration;
+		simulation.queueLimit = queueLimit();
+		simulation.setSeed(simulationSeed);
+		simulation.setWakeLatency(wakeLatency);
+		simulation.setSleepOvershoot(sleepOvershoot.count() >= 0 ? sleepOvershoot
+			: ProducerConsumerSimulation::calibratedSleepOvershoot(std::chrono::microseconds(builded.producerSleepTime)));
+		return simulation;
+	}
+	// settings with conflict() give a tester that only reports configurationFailed
+	ProducerConsumerTester build() {
+		if (!conflict().empty()) {
+			ProducerConsumerTester returned = std::move(builded);
+			builded = ProducerConsumerTester {};
+			return returned;
+		}
+		makeQueues();
+		makeStrategy();
+		ProducerConsumerTester returned = std::move(builded);
+		builded = ProducerConsumerTester {};
+		return returned;
+	}
+	// ring queue storage on huge pages and locked in RAM as options ask, if system allows
+	void setQueue(QueueKind queueKind, int queueCapacity = 1024, RingMemory::Options ringOptions = RingMemory::Options()) {
+		this->queueKind = queueKind;
+		this->queueCapacity = queueCapacity;
+		this->ringOptions = ringOptions;
+	}
+	// for QueueKind::DEADLINE: every item is due deadline after it is produced, plus random
+	// up to spread for counter producers, so earliest deadline first reorders them
+	void setDeadline(std::chrono::microseconds deadline,
+		std::chrono::microseconds spread = std::chrono::microseconds(0)) {
+		this->deadline = deadline;
+		builded.deadlineSpread = spread;
+	}
+	// for QueueKind::DELAY: every item is consumable delay after it is produced, not before,
+	// and at most resolution later when consumers ask for it
+	void setDelay(std::chrono::microseconds delay,
+		std::chrono::microseconds resolution = std::chrono::milliseconds(1)) {
+		this->delay = delay;
+		delayResolution = resolution;
+	}
+	// decorates queue with SizeLimitedQueue, 0 is unlimited;
+	// with TWO_LOCK strategy it limits TwoLockQueue itself
+	void setMaxSize(int maxSize) {
+		this->maxSize = maxSize;
+	}
+	// decorates queue with SequencedQueue, consumers then release items through ReorderBuffer;
+	// ignored with TWO_LOCK strategy, which has no lock to keep sequences under,
+	// and with deadline and delay queues, whose order is not the one sequences are kept in
+	void setSequenced(bool sequenced) {
+		this->sequenced = sequenced;
+	}
+	// TWO_LOCK runs its own TwoLockQueue, other queues conflict with it
+	void setStrategy(StrategyKind strategyKind = StrategyKind::SLEEP) {
+		this->strategyKind = strategyKind;
+	}
+	void setProducersCount(int producersCount) {
+		builded.producersCount = producersCount;
+	}
+	void setConsumersCount(int consumersCount) {
+		builded.consumersCount = consumersCount;
+	}
+	// consumers are run by AutoscalingConsumerPool between settings' min and max consumers,
+	// consumers count is then unused; pool threads are not pinned nor scheduled,
+	// batch size comes from setConsumeBatchSize
+	void setAutoscaling(bool autoscaling,
+		AutoscalingConsumerPool::Settings settings = AutoscalingConsumerPool::Settings()) {
+		builded.autoscaling = autoscaling;
+		builded.autoscaleSettings = settings;
+	}
+	void setArrivalProcess(ArrivalProcess arrival) {
+		builded.arrival = arrival;
+	}
+	void setProducerSleepTime(int producerSleepTime) {
+		builded.producerSleepTime = producerSleepTime;
+	}
+	// producers keep absolute schedule with Pacer, sleeping until spin before each deadline
+	void setPrecisePacing(bool precisePacing, std::chrono::microseconds spin = std::chrono::microseconds(50)) {
+		builded.precisePacing = precisePacing;
+		builded.pacingSpin = spin;
+	}
+	void setConsumerSleepTime(int consumerSleepTime) {
+		builded.consumerSleepTime = consumerSleepTime;
+	}
+	// consumers write consumed values to path through FileSink, path.N for consumer N when more than one;
+	// empty path disables
+	void setSinkFile(const std::string& path) {
+		builded.sinkPath = path;
+	}
+	// producers take values from file of raw ints in batches, without pauses, until file ends;
+	// test ends once it is all consumed, duration is then only a limit; empty path goes back to counter
+	void setSourceFile(const std::string& path, int produceBatchSize = 64) {
+		builded.sourcePath = path;
+		builded.produceBatchSize = produceBatchSize;
+	}
+	// intervals between produce calls each producer actually made, sleep overshoot included,
+	// saved to path at the end of test; empty path disables
+	void setTraceRecording(const std::string& path) {
+		builded.recordPath = path;
+	}
+	// producers replay intervals recorded by setTraceRecording, one producer per recorded one,
+	// instead of arrival process, on absolute schedule of Pacer; test ends once all are replayed
+	// and consumed, duration is then only a limit; empty path disables
+	void setTraceReplay(const std::string& path) {
+		builded.replayPath = path;
+	}
+	void setConsumeBatchSize(int consumeBatchSize) {
+		builded.consumeBatchSize = consumeBatchSize;
+	}
+	void setDuration(std::chrono::milliseconds duration) {
+		builded.duration = duration;
+	}
+	// same seed gives same simulation
+	void setSimulationSeed(unsigned seed) {
+		simulationSeed = seed;
+	}
+	// simulated time from notify to blocked thread running again
+	void setWakeLatency(std::chrono::nanoseconds wakeLatency) {
+		this->wakeLatency = wakeLatency;
+	}
+	// simulated lateness of every sleep, 0 by default; negative measures sleep_for of producers
+	// in buildSimulation(), once per process, and same seed then gives same simulation only within it
+	void setSleepOvershoot(std::chrono::nanoseconds sleepOvershoot) {
+		this->sleepOvershoot = sleepOvershoot;
+	}
+	void setPinning(const std::vector<int>& cpus) {
+		builded.cpus = cpus;
+	}
+	// real-time scheduling, priority 1 to 99 on Linux; failure is recorded in report, not fatal
+	void setProducersScheduling(SchedulingPolicy policy, int priority = 1) {
+		builded.producersPolicy = policy;
+		builded.producersPriority = priority;
+	}
+	void setConsumersScheduling(SchedulingPolicy policy, int priority = 1) {
+		builded.consumersPolicy = policy;
+		builded.consumersPriority = priority;
+	}
+	// status line to out every interval while test runs, nullptr disables
+	void setStatsReport(std::ostream* out, std::chrono::milliseconds interval = std::chrono::seconds(1)) {
+		builded.statsOut = out;
+		builded.statsInterval = interval;
+	}
+	// depth, full and empty sampled every interval, last samples series written to out at the end,
+	// nullptr disables
+	void setDepthSampling(std::ostream* out, std::chrono::microseconds interval = std::chrono::milliseconds(1),
+		int samples = 10000) {
+		builded.depthOut = out;
+		builded.depthInterval = interval;
+		builded.depthSamples = samples;
+	}
+	// Prometheus text format rewritten to path every interval and at the end, empty path disables;
+	// labels like scenario="name" are added to every metric
+	void setMetricsFile(const std::string& path, const std::string& labels = std::string(),
+		std::chrono::milliseconds interval = std::chrono::seconds(5)) {
+		builded.metricsPath = path;
+		builded.metricsLabels = labels;
+		builded.metricsInterval = interval;
+	}
 };
\ No newline at end of file
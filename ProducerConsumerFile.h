@@ -0,0 +1,526 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define PRODUCER_CONSUMER_IO_URING
+#endif
+#endif
+#endif
+
+#ifdef PRODUCER_CONSUMER_IO_URING
+// io_uring over raw system calls, no liburing: writes are queued in submission ring,
+// sent to kernel in one call and their completions read from completion ring without a call;
+// one thread queues, submits and reaps
+class IoUring {
+	int ringFd = -1;
+	void* sqMemory = MAP_FAILED;
+	void* cqMemory = MAP_FAILED;
+	size_t sqSize = 0;
+	size_t cqSize = 0;
+	io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t sqesSize = 0;
+	unsigned* sqHead = nullptr;
+	unsigned* sqTail = nullptr;
+	unsigned* sqArray = nullptr;
+	unsigned sqMask = 0;
+	unsigned sqEntries = 0;
+	unsigned* cqHead = nullptr;
+	unsigned* cqTail = nullptr;
+	io_uring_cqe* cqes = nullptr;
+	unsigned cqMask = 0;
+	unsigned queued = 0; // in submission ring, not sent yet
+	unsigned inFlight = 0; // sent, completion not reaped yet
+
+	template<class T> static T* at(void* memory, unsigned offset) {
+		return reinterpret_cast<T*>(static_cast<char*>(memory) + offset);
+	}
+public:
+	IoUring() = default;
+	IoUring(const IoUring&) = delete;
+	IoUring& operator=(const IoUring&) = delete;
+	// false if kernel has no io_uring or doesn't permit it
+	bool open(unsigned entries) {
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if (ringFd < 0) return false;
+		sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single) sqSize = cqSize = (std::max)(sqSize, cqSize);
+		sqMemory = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+		cqMemory = single ? sqMemory
+			: mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+		sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ringFd, IORING_OFF_SQES));
+		if (sqMemory == MAP_FAILED || cqMemory == MAP_FAILED || sqes == MAP_FAILED) {
+			close();
+			return false;
+		}
+		sqHead = at<unsigned>(sqMemory, params.sq_off.head);
+		sqTail = at<unsigned>(sqMemory, params.sq_off.tail);
+		sqArray = at<unsigned>(sqMemory, params.sq_off.array);
+		sqMask = *at<unsigned>(sqMemory, params.sq_off.ring_mask);
+		sqEntries = params.sq_entries;
+		cqHead = at<unsigned>(cqMemory, params.cq_off.head);
+		cqTail = at<unsigned>(cqMemory, params.cq_off.tail);
+		cqes = at<io_uring_cqe>(cqMemory, params.cq_off.cqes);
+		cqMask = *at<unsigned>(cqMemory, params.cq_off.ring_mask);
+		return true;
+	}
+	// sent writes must be reaped first, kernel may still read their buffers
+	void close() {
+		if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+		if (cqMemory != MAP_FAILED && cqMemory != sqMemory) munmap(cqMemory, cqSize);
+		if (sqMemory != MAP_FAILED) munmap(sqMemory, sqSize);
+		sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+		sqMemory = cqMemory = MAP_FAILED;
+		if (ringFd >= 0) ::close(ringFd);
+		ringFd = -1;
+		queued = inFlight = 0;
+	}
+	// false if submission ring is full
+	bool queueWrite(int fd, const iovec* vector, unsigned long long offset, unsigned long long userData) {
+		unsigned tail = *sqTail;
+		if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) return false;
+		unsigned index = tail & sqMask;
+		io_uring_sqe& sqe = sqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = IORING_OP_WRITEV;
+		sqe.fd = fd;
+		sqe.addr = reinterpret_cast<unsigned long long>(vector);
+		sqe.len = 1;
+		sqe.off = offset;
+		sqe.user_data = userData;
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		++queued;
+		return true;
+	}
+	// sends queued writes and, with wait, blocks until a completion is ready; false on error
+	bool submit(bool wait) {
+		while (true) {
+			long sent = syscall(__NR_io_uring_enter, ringFd, queued, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0,
+				nullptr, 0);
+			if (sent >= 0) {
+				queued -= static_cast<unsigned>(sent);
+				inFlight += static_cast<unsigned>(sent);
+				return true;
+			}
+			if (errno != EINTR) return false;
+		}
+	}
+	// done(userData, result) for every ready completion, result is bytes written or -errno
+	template<class Done> int reap(Done done) {
+		unsigned head = *cqHead;
+		unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		int reaped = 0;
+		for (; head != tail; ++head, ++reaped) {
+			const io_uring_cqe& cqe = cqes[head & cqMask];
+			--inFlight;
+			done(cqe.user_data, cqe.res);
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		return reaped;
+	}
+	unsigned submitted() const { return inFlight; }
+	unsigned waiting() const { return queued; }
+	~IoUring() { close(); }
+};
+#endif
+
+// writes consumed values to a file without waiting for disk:
+// write() copies into one of preallocated buffers; on Linux full buffers are queued to io_uring,
+// sent to kernel half of buffers at a time and taken back as their completions are reaped,
+// elsewhere or without io_uring they are written by own thread;
+// consumer waits only when all buffers are waiting for disk (counted in stalls);
+// one consumer per sink
+class FileSink {
+	std::vector<std::vector<char>> buffers;
+	std::deque<int> freeBuffers; // guarded by buffersLock
+	std::deque<std::pair<int, size_t>> fullBuffers; // index and used bytes, guarded by buffersLock
+	std::mutex buffersLock;
+	std::condition_variable onFree;
+	std::condition_variable onFull;
+	bool closing = false;
+	std::FILE* file = nullptr;
+	std::thread writer;
+	// consumer side
+	int current = -1;
+	size_t used = 0;
+	long long stallsCount = 0;
+	// writer side
+	std::atomic<long long> writtenBytes;
+	std::atomic<bool> writeFailed;
+#ifdef PRODUCER_CONSUMER_IO_URING
+	// consumer side too, buffers are not shared with a writer thread
+	IoUring ring;
+	bool ringUsed = false;
+	std::vector<iovec> vectors; // per buffer, rest of its write
+	std::vector<long long> offsets; // per buffer, file offset of rest of its write
+	long long fileOffset = 0;
+
+	void queueWrite(int index) {
+		if (!ring.queueWrite(fileno(file), &vectors[index], offsets[index], index)) {
+			// ring has an entry per buffer, so it is never full
+			writeFailed = true;
+			freeBuffers.push_back(index);
+			return;
+		}
+		if (ring.waiting() >= (std::max)(static_cast<size_t>(1), buffers.size() / 2) && !ring.submit(false)) {
+			writeFailed = true;
+		}
+	}
+	void reapWrites() {
+		ring.reap([this](unsigned long long userData, int result) {
+			int index = static_cast<int>(userData);
+			iovec& rest = vectors[index];
+			if (result < 0) writeFailed = true;
+			else {
+				writtenBytes.fetch_add(result, std::memory_order_relaxed);
+				if (result > 0 && static_cast<size_t>(result) < rest.iov_len) {
+					// short write, rest goes again
+					rest.iov_base = static_cast<char*>(rest.iov_base) + result;
+					rest.iov_len -= result;
+					offsets[index] += result;
+					queueWrite(index);
+					return;
+				}
+				if (result == 0 && rest.iov_len > 0) writeFailed = true;
+			}
+			freeBuffers.push_back(index);
+		});
+	}
+	// false if kernel refused, buffers still in kernel are then never taken back
+	// and sink stops writing
+	bool awaitWrite() {
+		if (!ring.submit(true)) {
+			writeFailed = true;
+			return false;
+		}
+		reapWrites();
+		return true;
+	}
+#endif
+
+	void submit() {
+		if (current < 0) return;
+#ifdef PRODUCER_CONSUMER_IO_URING
+		if (ringUsed) {
+			vectors[current].iov_base = buffers[current].data();
+			vectors[current].iov_len = used;
+			offsets[current] = fileOffset;
+			fileOffset += static_cast<long long>(used);
+			queueWrite(current);
+			current = -1;
+			used = 0;
+			return;
+		}
+#endif
+		{
+			std::unique_lock<std::mutex> locker(buffersLock);
+			fullBuffers.emplace_back(current, used);
+		}
+		onFull.notify_one();
+		current = -1;
+		used = 0;
+	}
+	// false if no buffer will be free again
+	bool acquire() {
+#ifdef PRODUCER_CONSUMER_IO_URING
+		if (ringUsed) {
+			reapWrites();
+			if (freeBuffers.empty()) ++stallsCount;
+			while (freeBuffers.empty()) {
+				if (!awaitWrite()) return false;
+			}
+			current = freeBuffers.front();
+			freeBuffers.pop_front();
+			return true;
+		}
+#endif
+		std::unique_lock<std::mutex> locker(buffersLock);
+		if (freeBuffers.empty()) {
+			++stallsCount;
+			onFree.wait(locker, [this]() { return !freeBuffers.empty(); });
+		}
+		current = freeBuffers.front();
+		freeBuffers.pop_front();
+		return true;
+	}
+	void writeBuffers() {
+		std::unique_lock<std::mutex> locker(buffersLock);
+		while (true) {
+			onFull.wait(locker, [this]() { return closing || !fullBuffers.empty(); });
+			if (fullBuffers.empty()) return;
+			std::pair<int, size_t> full = fullBuffers.front();
+			fullBuffers.pop_front();
+			locker.unlock();
+			if (std::fwrite(buffers[full.first].data(), 1, full.second, file) == full.second) {
+				writtenBytes.fetch_add(static_cast<long long>(full.second), std::memory_order_relaxed);
+			}
+			else writeFailed = true;
+			locker.lock();
+			freeBuffers.push_back(full.first);
+			onFree.notify_one();
+		}
+	}
+public:
+	FileSink(int buffersCount = 4, size_t bufferSize = 1 << 20)
+		: buffers(buffersCount > 1 ? buffersCount : 2, std::vector<char>(bufferSize > 0 ? bufferSize : 1)),
+		writtenBytes(0), writeFailed(false) {
+		for (int i = 0; i < static_cast<int>(buffers.size()); ++i) freeBuffers.push_back(i);
+	}
+	FileSink(const FileSink&) = delete;
+	FileSink& operator=(const FileSink&) = delete;
+	// false if file can't be created
+	bool open(const std::string& path) {
+		file = std::fopen(path.c_str(), "wb");
+		if (!file) return false;
+		// buffers are ours, no second copy in stdio
+		std::setvbuf(file, nullptr, _IONBF, 0);
+#ifdef PRODUCER_CONSUMER_IO_URING
+		// ring too small for all buffers would have to be waited for, writer thread is used then
+		ringUsed = ring.open(static_cast<unsigned>(buffers.size()));
+		if (ringUsed) {
+			vectors.resize(buffers.size());
+			offsets.resize(buffers.size());
+			return true;
+		}
+#endif
+		writer = std::thread(&FileSink::writeBuffers, this);
+		return true;
+	}
+	void write(const int* values, int count) {
+		if (!file) return;
+		const char* bytes = reinterpret_cast<const char*>(values);
+		size_t size = static_cast<size_t>(count) * sizeof(int);
+		while (size > 0) {
+			if (current < 0 && !acquire()) return;
+			std::vector<char>& buffer = buffers[current];
+			size_t copied = (std::min)(size, buffer.size() - used);
+			std::memcpy(buffer.data() + used, bytes, copied);
+			used += copied;
+			bytes += copied;
+			size -= copied;
+			if (used == buffer.size()) submit();
+		}
+	}
+	// writes what is left and waits for disk
+	void close() {
+		if (!file) return;
+		if (used > 0) submit();
+#ifdef PRODUCER_CONSUMER_IO_URING
+		if (ringUsed) {
+			bool waited = true;
+			while (waited && (ring.waiting() > 0 || ring.submitted() > 0)) waited = awaitWrite();
+			reapWrites();
+			ring.close();
+			ringUsed = false;
+			if (std::fclose(file) != 0) writeFailed = true;
+			file = nullptr;
+			return;
+		}
+#endif
+		{
+			std::unique_lock<std::mutex> locker(buffersLock);
+			closing = true;
+		}
+		onFull.notify_one();
+		writer.join();
+		if (std::fclose(file) != 0) writeFailed = true;
+		file = nullptr;
+	}
+	~FileSink() { close(); }
+	long long written() const { return writtenBytes.load(std::memory_order_relaxed); }
+	// writes that waited for a free buffer, consumer side only
+	long long stalls() const { return stallsCount; }
+	bool failed() const { return writeFailed.load(); }
+};
+
+// values of a file of raw ints, as written by FileSink, mapped into memory:
+// producers take batches straight from the mapping, no read call and no copy per record;
+// next() is safe for several producers
+class FileSource {
+	const int* values = nullptr;
+	size_t valuesCount = 0;
+	std::atomic<size_t> cursor;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	void* mapped = MAP_FAILED;
+	size_t mappedSize = 0;
+#endif
+public:
+	FileSource() : cursor(0) {}
+	FileSource(const FileSource&) = delete;
+	FileSource& operator=(const FileSource&) = delete;
+	// false if file can't be mapped or is empty, trailing bytes of partial record are ignored
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		// sequential scan makes cache manager read ahead aggressively
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(int))) {
+			close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (!view) {
+			close();
+			return false;
+		}
+		values = static_cast<const int*>(view);
+		valuesCount = static_cast<size_t>(size.QuadPart) / sizeof(int);
+#else
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) return false;
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(int))) {
+			::close(descriptor);
+			return false;
+		}
+		mappedSize = static_cast<size_t>(status.st_size);
+		mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		// mapping keeps file open
+		::close(descriptor);
+		if (mapped == MAP_FAILED) return false;
+		// read ahead, drop pages behind
+		madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+		values = static_cast<const int*>(mapped);
+		valuesCount = mappedSize / sizeof(int);
+#endif
+		cursor = 0;
+		return true;
+	}
+	void close() {
+#ifdef _WIN32
+		if (values) UnmapViewOfFile(values);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (mapped != MAP_FAILED) munmap(mapped, mappedSize);
+		mapped = MAP_FAILED;
+		mappedSize = 0;
+#endif
+		values = nullptr;
+		valuesCount = 0;
+	}
+	~FileSource() { close(); }
+	// points batch at up to maxCount next values, 0 at end of file
+	int next(const int*& batch, int maxCount) {
+		if (maxCount <= 0) return 0;
+		size_t first = cursor.fetch_add(static_cast<size_t>(maxCount), std::memory_order_relaxed);
+		if (first >= valuesCount) return 0;
+		batch = values + first;
+		return static_cast<int>((std::min)(static_cast<size_t>(maxCount), valuesCount - first));
+	}
+	const int* data() const { return values; }
+	size_t count() const { return valuesCount; }
+};
+
+// inter-arrival intervals of every producer, in nanoseconds, so workload can be replayed
+// on another machine or with another strategy without rounding drift; payloads are fixed size ints,
+// nothing to record; file: "PCAT", version byte, then varints: streams count, and per stream
+// intervals count and intervals; version 1 files hold microseconds and are still read
+class ArrivalTrace {
+	static const unsigned char VERSION = 2;
+	static const unsigned char MICROSECONDS_VERSION = 1;
+
+	static void putVarint(std::vector<unsigned char>& bytes, unsigned long long value) {
+		while (value >= 0x80) {
+			bytes.push_back(static_cast<unsigned char>(value | 0x80));
+			value >>= 7;
+		}
+		bytes.push_back(static_cast<unsigned char>(value));
+	}
+	static bool getVarint(const std::vector<unsigned char>& bytes, size_t& position, unsigned long long& value) {
+		value = 0;
+		for (int shift = 0; shift < 64 && position < bytes.size(); shift += 7) {
+			unsigned char byte = bytes[position++];
+			value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;
+	}
+public:
+	std::vector<std::vector<long long>> streams; // one per producer, nanoseconds
+
+	// false if file can't be written
+	bool save(const std::string& path) const {
+		std::vector<unsigned char> bytes = { 'P', 'C', 'A', 'T', VERSION };
+		putVarint(bytes, streams.size());
+		for (const std::vector<long long>& stream : streams) {
+			putVarint(bytes, stream.size());
+			for (long long interval : stream) putVarint(bytes, static_cast<unsigned long long>((std::max)(interval, 0LL)));
+		}
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file) return false;
+		bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		return std::fclose(file) == 0 && written;
+	}
+	// false if file can't be read or is not a trace
+	bool load(const std::string& path) {
+		streams.clear();
+		std::FILE* file = std::fopen(path.c_str(), "rb");
+		if (!file) return false;
+		std::vector<unsigned char> bytes;
+		unsigned char chunk[1 << 16];
+		size_t read;
+		while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) bytes.insert(bytes.end(), chunk, chunk + read);
+		std::fclose(file);
+		if (bytes.size() < 5 || std::memcmp(bytes.data(), "PCAT", 4) != 0) return false;
+		if (bytes[4] != VERSION && bytes[4] != MICROSECONDS_VERSION) return false;
+		const long long unit = bytes[4] == MICROSECONDS_VERSION ? 1000 : 1;
+		size_t position = 5;
+		unsigned long long streamsCount = 0, count = 0, interval = 0;
+		// counts are checked against file size, so broken file can't make us allocate much
+		if (!getVarint(bytes, position, streamsCount) || streamsCount > bytes.size()) return false;
+		streams.resize(static_cast<size_t>(streamsCount));
+		for (std::vector<long long>& stream : streams) {
+			if (!getVarint(bytes, position, count) || count > bytes.size() - position) {
+				streams.clear();
+				return false;
+			}
+			stream.reserve(static_cast<size_t>(count));
+			while (count--) {
+				if (!getVarint(bytes, position, interval)) {
+					streams.clear();
+					return false;
+				}
+				stream.push_back(static_cast<long long>(interval) * unit);
+			}
+		}
+		return true;
+	}
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+// analytic queueing model of producers and consumers, from measured rates:
+// Poisson arrivals, consumers are servers; M/M/c waiting (Erlang C) corrected for general service
+// by Allen-Cunneen, which is exactly Pollaczek-Khinchine (M/G/1) for one consumer;
+// full queue probability from M/M/c/K, K being consumers plus queue limit;
+// with batchSize above 1 service is bulk, as in test(): a consumer sleeps for service time,
+// then takes up to batchSize queued items at once; an item waits for the next consumer to wake,
+// each consumer's wake taken uniform over twice its mean residual service time, plus the
+// Allen-Cunneen wait on servers of batchSize items per service, which counts only near
+// saturation when batches fill up; K is then the queue limit alone
+struct QueueModel {
+	double arrivalRate = 0; // items per second
+	double serviceRate = 0; // services per second of one consumer
+	double serviceCv2 = 1; // squared coefficient of variation of service time, 1 is exponential
+	int consumers = 1;
+	int batchSize = 1; // items one service takes at most
+
+	// items per second of one consumer that always finds a full batch
+	double itemRate() const { return serviceRate * batchSize; }
+
+	struct Prediction {
+		bool stable = false; // arrivals below capacity, other fields are meaningless otherwise
+		double utilisation = 0;
+		double waitProbability = 0; // item finds all consumers busy
+		double meanWait = 0; // seconds in queue before service
+		double latency = 0; // seconds, percentile of wait plus mean service
+		double fullProbability = 0; // producer finds queue full, 0 for unlimited
+	};
+
+	// probability that all servers are busy, Erlang C
+	static double erlangC(int servers, double offered) {
+		if (servers <= 0 || offered >= servers) return 1;
+		// Erlang B by recurrence, stable for many servers
+		double erlangB = 1;
+		for (int k = 1; k <= servers; ++k) erlangB = offered * erlangB / (k + offered * erlangB);
+		double utilisation = offered / servers;
+		return erlangB / (1 - utilisation + utilisation * erlangB);
+	}
+	// probability of system holding capacity items in M/M/c/capacity
+	static double fullProbability(int servers, int capacity, double offered) {
+		if (capacity <= 0) return 0;
+		// each state relative to previous one, rescaled to keep them finite
+		double term = 1, total = 1;
+		for (int n = 1; n <= capacity; ++n) {
+			term *= offered / (std::min)(n, servers);
+			total += term;
+			if (total > 1e250) {
+				term /= total;
+				total = 1;
+			}
+		}
+		return term / total;
+	}
+
+	// queueLimit 0 is unlimited, percentile in (0, 1)
+	Prediction predict(int queueLimit, double percentile) const {
+		Prediction prediction;
+		if (serviceRate <= 0 || consumers <= 0 || batchSize <= 0) return prediction;
+		const bool bulk = batchSize > 1;
+		double offered = arrivalRate / itemRate();
+		prediction.utilisation = offered / consumers;
+		if (queueLimit > 0) {
+			prediction.fullProbability = fullProbability(consumers, (bulk ? 0 : consumers) + queueLimit, offered);
+		}
+		prediction.stable = prediction.utilisation < 1;
+		if (!prediction.stable) return prediction;
+		prediction.waitProbability = erlangC(consumers, offered);
+		double drain = consumers * itemRate() - arrivalRate;
+		double queued = prediction.waitProbability / drain * (1 + serviceCv2) / 2;
+		// waiting time tail is taken exponential with the corrected mean
+		double tail = 1 - percentile;
+		double wait = 0;
+		if (prediction.waitProbability > tail && prediction.waitProbability > 0) {
+			wait = queued / prediction.waitProbability * std::log(prediction.waitProbability / tail);
+		}
+		// limited queue drains in bounded time, blocked producers hold the rest
+		if (queueLimit > 0) wait = (std::min)(wait, queueLimit / (consumers * itemRate()));
+		if (!bulk) {
+			prediction.meanWait = queued;
+			prediction.latency = wait + 1 / serviceRate;
+			return prediction;
+		}
+		// earliest of consumers wakes, each uniform on [0, cycle)
+		double cycle = (1 + serviceCv2) / serviceRate;
+		prediction.meanWait = queued + cycle / (consumers + 1);
+		prediction.latency = wait + cycle * (1 - std::pow(tail, 1.0 / consumers));
+		return prediction;
+	}
+
+	struct Recommendation {
+		bool found = false;
+		int consumers = 0;
+		int queueLimit = 0;
+	};
+	// fewest consumers meeting latency target (0 is none) below maxUtilisation,
+	// then smallest queue limit whose full probability is at most targetFull
+	Recommendation recommend(double targetFull, double percentile, double targetLatency,
+		double maxUtilisation = 0.9, int maxConsumers = 1024, int maxLimit = 1 << 20) const {
+		Recommendation recommendation;
+		if (serviceRate <= 0 || batchSize <= 0) return recommendation;
+		QueueModel candidate(*this);
+		for (candidate.consumers = 1; candidate.consumers <= maxConsumers; ++candidate.consumers) {
+			Prediction prediction = candidate.predict(0, percentile);
+			if (!prediction.stable || prediction.utilisation > maxUtilisation) continue;
+			if (targetLatency > 0 && prediction.latency > targetLatency) continue;
+			break;
+		}
+		if (candidate.consumers > maxConsumers) return recommendation;
+		double offered = arrivalRate / itemRate();
+		// items in service count against the limit only for one at a time service
+		int served = batchSize > 1 ? 0 : candidate.consumers;
+		// full probability falls as limit grows, doubling then bisecting
+		int high = 1;
+		while (high < maxLimit && fullProbability(candidate.consumers, served + high, offered) > targetFull) {
+			high = (std::min)(high * 2, maxLimit);
+		}
+		int low = high / 2 + 1;
+		while (low < high) {
+			int middle = low + (high - low) / 2;
+			if (fullProbability(candidate.consumers, served + middle, offered) > targetFull) low = middle + 1;
+			else high = middle;
+		}
+		recommendation.found = fullProbability(candidate.consumers, served + high, offered) <= targetFull;
+		recommendation.consumers = candidate.consumers;
+		recommendation.queueLimit = high;
+		return recommendation;
+	}
+};
@@ -1,176 +1,176 @@
-
-// ProducerConsumerProblemDlg.cpp : implementation file
-//
-
-#include "stdafx.h"
-#include "ProducerConsumerProblem.h"
-#include "ProducerConsumerProblemDlg.h"
-#include "afxdialogex.h"
-
-#include "ProducerConsumer.h"
-
-#ifdef _DEBUG
-#define new DEBUG_NEW
-#endif
-
-
-// CAboutDlg dialog used for App About
-
-class CAboutDlg : public CDialogEx
-{
-public:
-	CAboutDlg();
-// Dialog Data
-#ifdef AFX_DESIGN_TIME
-	enum { IDD = IDD_ABOUTBOX };
-#endif
-
-	protected:
-	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV support
-
-// Implementation
-protected:
-	DECLARE_MESSAGE_MAP()
-};
-
-CAboutDlg::CAboutDlg() : CDialogEx(IDS_ABOUTBOX)
-{
-}
-
-void CAboutDlg::DoDataExchange(CDataExchange* pDX)
-{
-	CDialogEx::DoDataExchange(pDX);
-}
-
-BEGIN_MESSAGE_MAP(CAboutDlg, CDialogEx)
-END_MESSAGE_MAP()
-
-
-// CProducerConsumerProblemDlg dialog
-
-
-
-CProducerConsumerProblemDlg::CProducerConsumerProblemDlg(CWnd* pParent /*=NULL*/)
-	: CDialogEx(IDD_PRODUCERCONSUMERPROBLEM_DIALOG, pParent), producerSleepTimeView(0), outputView(_T("")) {
-	m_hIcon = AfxGetApp()->LoadIcon(IDR_MAINFRAME);
-}
-
-CProducerConsumerProblemDlg & CProducerConsumerProblemDlg::Get() {
-	// pattern: singleton
-	static CProducerConsumerProblemDlg single;
-	return single;
-}
-
-void CProducerConsumerProblemDlg::DoDataExchange(CDataExchange* pDX)
-{
-	CDialogEx::DoDataExchange(pDX);
-	DDX_Slider(pDX, IDC_SLIDERPST, producerSleepTimeView);
-	DDV_MinMaxInt(pDX, producerSleepTimeView, 1, 1000);
-	DDX_Text(pDX, IDC_OUTPUT, outputView);
-}
-
-BEGIN_MESSAGE_MAP(CProducerConsumerProblemDlg, CDialogEx)
-	ON_WM_SYSCOMMAND()
-	ON_WM_PAINT()
-	ON_WM_QUERYDRAGICON()
-	ON_BN_CLICKED(IDC_BUTTONSTART, &CProducerConsumerProblemDlg::OnBnClickedButtonstart)
-END_MESSAGE_MAP()
-
-
-// CProducerConsumerProblemDlg message handlers
-
-BOOL CProducerConsumerProblemDlg::OnInitDialog()
-{
-	CDialogEx::OnInitDialog();
-
-	// Add "About..." menu item to system menu.
-
-	// IDM_ABOUTBOX must be in the system command range.
-	ASSERT((IDM_ABOUTBOX & 0xFFF0) == IDM_ABOUTBOX);
-	ASSERT(IDM_ABOUTBOX < 0xF000);
-
-	CMenu* pSysMenu = GetSystemMenu(FALSE);
-	if (pSysMenu != NULL)
-	{
-		BOOL bNameValid;
-		CString strAboutMenu;
-		bNameValid = strAboutMenu.LoadString(IDS_ABOUTBOX);
-		ASSERT(bNameValid);
-		if (!strAboutMenu.IsEmpty())
-		{
-			pSysMenu->AppendMenu(MF_SEPARATOR);
-			pSysMenu->AppendMenu(MF_STRING, IDM_ABOUTBOX, strAboutMenu);
-		}
-	}
-
-	// Set the icon for this dialog.  The framework does this automatically
-	//  when the application's main window is not a dialog
-	SetIcon(m_hIcon, TRUE);			// Set big icon
-	SetIcon(m_hIcon, FALSE);		// Set small icon
-
-	// TODO: Add extra initialization here
-
-	return TRUE;  // return TRUE  unless you set the focus to a control
-}
-
-void CProducerConsumerProblemDlg::OnSysCommand(UINT nID, LPARAM lParam)
-{
-	if ((nID & 0xFFF0) == IDM_ABOUTBOX)
-	{
-		CAboutDlg dlgAbout;
-		dlgAbout.DoModal();
-	}
-	else
-	{
-		CDialogEx::OnSysCommand(nID, lParam);
-	}
-}
-
-// If you add a minimize button to your dialog, you will need the code below
-//  to draw the icon.  For MFC applications using the document/view model,
-//  this is automatically done for you by the framework.
-
-void CProducerConsumerProblemDlg::OnPaint()
-{
-	if (IsIconic())
-	{
-		CPaintDC dc(this); // device context for painting
-
-		SendMessage(WM_ICONERASEBKGND, reinterpret_cast<WPARAM>(dc.GetSafeHdc()), 0);
-
-		// Center icon in client rectangle
-		int cxIcon = GetSystemMetrics(SM_CXICON);
-		int cyIcon = GetSystemMetrics(SM_CYICON);
-		CRect rect;
-		GetClientRect(&rect);
-		int x = (rect.Width() - cxIcon + 1) / 2;
-		int y = (rect.Height() - cyIcon + 1) / 2;
-
-		// Draw the icon
-		dc.DrawIcon(x, y, m_hIcon);
-	}
-	else
-	{
-		CDialogEx::OnPaint();
-	}
-}
-
-// The system calls this function to obtain the cursor to display while the user drags
-//  the minimized window.
-HCURSOR CProducerConsumerProblemDlg::OnQueryDragIcon()
-{
-	return static_cast<HCURSOR>(m_hIcon);
-}
-
-
-
-void CProducerConsumerProblemDlg::OnBnClickedButtonstart() {
-	UpdateData(TRUE);
-	ProducerConsumerTesterBuilder builder;
-	builder.setProducerSleepTime(producerSleepTimeView);
-	builder.setStrategy();
-	ProducerConsumerTester tester = builder.build();
-	//tester.test();
-	outputView = "Done!";
-	UpdateData(FALSE);
-}
+
+// ProducerConsumerProblemDlg.cpp : implementation file
+//
+
+#include "stdafx.h"
+#include "ProducerConsumerProblem.h"
+#include "ProducerConsumerProblemDlg.h"
+#include "afxdialogex.h"
+
+#include "ProducerConsumer.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+// CAboutDlg dialog used for App About
+
+class CAboutDlg : public CDialogEx
+{
+public:
+	CAboutDlg();
+// Dialog Data
+#ifdef AFX_DESIGN_TIME
+	enum { IDD = IDD_ABOUTBOX };
+#endif
+
+	protected:
+	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV support
+
+// Implementation
+protected:
+	DECLARE_MESSAGE_MAP()
+};
+
+CAboutDlg::CAboutDlg() : CDialogEx(IDS_ABOUTBOX)
+{
+}
+
+void CAboutDlg::DoDataExchange(CDataExchange* pDX)
+{
+	CDialogEx::DoDataExchange(pDX);
+}
+
+BEGIN_MESSAGE_MAP(CAboutDlg, CDialogEx)
+END_MESSAGE_MAP()
+
+
+// CProducerConsumerProblemDlg dialog
+
+
+
+CProducerConsumerProblemDlg::CProducerConsumerProblemDlg(CWnd* pParent /*=NULL*/)
+	: CDialogEx(IDD_PRODUCERCONSUMERPROBLEM_DIALOG, pParent), producerSleepTimeView(0), outputView(_T("")) {
+	m_hIcon = AfxGetApp()->LoadIcon(IDR_MAINFRAME);
+}
+
+CProducerConsumerProblemDlg & CProducerConsumerProblemDlg::Get() {
+	// pattern: singleton
+	static CProducerConsumerProblemDlg single;
+	return single;
+}
+
+void CProducerConsumerProblemDlg::DoDataExchange(CDataExchange* pDX)
+{
+	CDialogEx::DoDataExchange(pDX);
+	DDX_Slider(pDX, IDC_SLIDERPST, producerSleepTimeView);
+	DDV_MinMaxInt(pDX, producerSleepTimeView, 1, 1000);
+	DDX_Text(pDX, IDC_OUTPUT, outputView);
+}
+
+BEGIN_MESSAGE_MAP(CProducerConsumerProblemDlg, CDialogEx)
+	ON_WM_SYSCOMMAND()
+	ON_WM_PAINT()
+	ON_WM_QUERYDRAGICON()
+	ON_BN_CLICKED(IDC_BUTTONSTART, &CProducerConsumerProblemDlg::OnBnClickedButtonstart)
+END_MESSAGE_MAP()
+
+
+// CProducerConsumerProblemDlg message handlers
+
+BOOL CProducerConsumerProblemDlg::OnInitDialog()
+{
+	CDialogEx::OnInitDialog();
+
+	// Add "About..." menu item to system menu.
+
+	// IDM_ABOUTBOX must be in the system command range.
+	ASSERT((IDM_ABOUTBOX & 0xFFF0) == IDM_ABOUTBOX);
+	ASSERT(IDM_ABOUTBOX < 0xF000);
+
+	CMenu* pSysMenu = GetSystemMenu(FALSE);
+	if (pSysMenu != NULL)
+	{
+		BOOL bNameValid;
+		CString strAboutMenu;
+		bNameValid = strAboutMenu.LoadString(IDS_ABOUTBOX);
+		ASSERT(bNameValid);
+		if (!strAboutMenu.IsEmpty())
+		{
+			pSysMenu->AppendMenu(MF_SEPARATOR);
+			pSysMenu->AppendMenu(MF_STRING, IDM_ABOUTBOX, strAboutMenu);
+		}
+	}
+
+	// Set the icon for this dialog.  The framework does this automatically
+	//  when the application's main window is not a dialog
+	SetIcon(m_hIcon, TRUE);			// Set big icon
+	SetIcon(m_hIcon, FALSE);		// Set small icon
+
+	// TODO: Add extra initialization here
+
+	return TRUE;  // return TRUE  unless you set the focus to a control
+}
+
+void CProducerConsumerProblemDlg::OnSysCommand(UINT nID, LPARAM lParam)
+{
+	if ((nID & 0xFFF0) == IDM_ABOUTBOX)
+	{
+		CAboutDlg dlgAbout;
+		dlgAbout.DoModal();
+	}
+	else
+	{
+		CDialogEx::OnSysCommand(nID, lParam);
+	}
+}
+
+// If you add a minimize button to your dialog, you will need the code below
+//  to draw the icon.  For MFC applications using the document/view model,
+//  this is automatically done for you by the framework.
+
+void CProducerConsumerProblemDlg::OnPaint()
+{
+	if (IsIconic())
+	{
+		CPaintDC dc(this); // device context for painting
+
+		SendMessage(WM_ICONERASEBKGND, reinterpret_cast<WPARAM>(dc.GetSafeHdc()), 0);
+
+		// Center icon in client rectangle
+		int cxIcon = GetSystemMetrics(SM_CXICON);
+		int cyIcon = GetSystemMetrics(SM_CYICON);
+		CRect rect;
+		GetClientRect(&rect);
+		int x = (rect.Width() - cxIcon + 1) / 2;
+		int y = (rect.Height() - cyIcon + 1) / 2;
+
+		// Draw the icon
+		dc.DrawIcon(x, y, m_hIcon);
+	}
+	else
+	{
+		CDialogEx::OnPaint();
+	}
+}
+
+// The system calls this function to obtain the cursor to display while the user drags
+//  the minimized window.
+HCURSOR CProducerConsumerProblemDlg::OnQueryDragIcon()
+{
+	return static_cast<HCURSOR>(m_hIcon);
+}
+
+
+
+void CProducerConsumerProblemDlg::OnBnClickedButtonstart() {
+	UpdateData(TRUE);
+	ProducerConsumerTesterBuilder builder;
+	builder.setProducerSleepTime(producerSleepTimeView);
+	builder.setStrategy();
+	ProducerConsumerTester tester = builder.build();
+	//tester.test();
+	outputView = "Done!";
+	UpdateData(FALSE);
+}
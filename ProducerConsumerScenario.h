@@ -0,0 +1,592 @@
+#pragma once
+
+#include "ProducerConsumer.h"
+#include "ProducerConsumerModel.h"
+
+#include <string>
+#include <map>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <cctype>
+#include <locale>
+#include <algorithm>
+#include <iterator>
+
+// benchmark scenarios in INI format, one section per scenario:
+//
+// [name]
+// mode = test | simulate           ; simulate runs discrete-event model in virtual time,
+//                                    keys it can't model are errors with it
+// queue = queue | ring | twolock | deadline | delay ; deadline is earliest deadline first, result line
+//                                    counts missed deadlines, n/a for other queues; delay holds items back,
+//                                    result line counts ones released early
+// capacity = 1024                  ; ring queue capacity
+// hugePages = false                ; ring queue storage on huge pages, result line shows if obtained
+// lockMemory = false               ; ring queue storage locked in RAM, result line shows if obtained
+// deadline = 1000                  ; deadline queue, microseconds from produce to item's deadline
+// deadlineSpread = 0               ; deadline queue, random microseconds added per item, reorders items
+// delay = 1000                     ; delay queue, microseconds from produce to item being consumable
+// resolution = 1000                ; delay queue, microseconds per timing wheel tick
+// decorators = sizelimited, sequenced ; sequenced items are released in order after consumers,
+//                                    none with strategy twolock, no sequenced with deadline or delay queue
+// maxSize = 100                    ; needed by sizelimited, without it only for strategy twolock
+// strategy = sleep | wait | bruteforce | adaptive | twolock | pause | yield | exponential | jittered
+// producers = 1
+// consumers = 1
+// autoscale = false                ; consumers grow and shrink with depth and utilisation instead of consumers,
+//                                    their threads are not pinned nor scheduled; result line shows decisions
+// minConsumers = 1                 ; autoscale, consumers at start and at least
+// maxConsumers = 4                 ; autoscale, consumers at most
+// scaleInterval = 100              ; autoscale, milliseconds between depth and utilisation samples
+// arrival = uniform | poisson | constant
+// producerSleepTime = 100          ; microseconds, mean between produced items
+// pacing = sleep | precise          ; precise keeps producers on absolute schedule
+// pacingSpin = 50                  ; microseconds spun before each deadline
+// consumerSleepTime = 100
+// batch = 64                       ; consume batch size
+// source = recorded.bin           ; values produced from file of raw ints instead of counter, at full speed,
+//                                    test ends when all are consumed
+// sourceBatch = 64                 ; values per produceBulk from source
+// recordTrace = arrivals.trace     ; producers intervals saved for replay
+// replayTrace = arrivals.trace     ; producers and their intervals taken from trace, arrival is ignored
+// sink = consumed.bin              ; consumed values written as raw ints, .N suffix per consumer if more,
+//                                    with autoscale per pool slot
+// duration = 10000                 ; milliseconds
+// pin = 0, 1                       ; cpus, round robin, producers first
+// producersPolicy = normal | fifo | rr   ; real-time scheduling, needs privileges
+// producersPriority = 1
+// consumersPolicy = normal | fifo | rr
+// consumersPriority = 1
+// model = true                     ; queueing model predictions and recommendation after results
+// targetFull = 0.001               ; for recommendation, probability of producer finding queue full
+// targetPercentile = 0.99
+// targetLatency = 0                ; microseconds at targetPercentile, 0 is none
+// report = 1000                    ; milliseconds between live status lines
+// metrics = metrics.prom           ; Prometheus text format file, labelled scenario="name"
+// metricsInterval = 5000           ; milliseconds between metrics file writes
+// depth = 1000                     ; microseconds between queue depth samples, series written at the end
+// depthSamples = 10000             ; last samples kept
+// seed = 1                         ; simulate only, same seed gives same run
+// wakeLatency = 5                  ; simulate only, microseconds from notify to blocked thread running
+// sleepOvershoot = 0               ; simulate only, microseconds every sleep is late, auto measures sleep_for
+//                                    once per run of the program, so results then vary between machines and runs
+//
+// missing keys keep builder defaults, ; and # start comments
+struct Scenario {
+	std::string name;
+	std::map<std::string, std::string> settings;
+};
+
+inline std::string trimmed(const std::string& text) {
+	size_t begin = 0, end = text.size();
+	while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) ++begin;
+	while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) --end;
+	return text.substr(begin, end - begin);
+}
+
+inline std::string lowered(std::string text) {
+	for (char& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	return text;
+}
+
+inline std::vector<std::string> splitList(const std::string& text) {
+	std::vector<std::string> items;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		item = trimmed(item);
+		if (!item.empty()) items.push_back(item);
+	}
+	return items;
+}
+
+// false and error with line number on malformed input
+inline bool parseScenarios(std::istream& in, std::vector<Scenario>& scenarios, std::string& error) {
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line)) {
+		++lineNumber;
+		size_t comment = line.find_first_of(";#");
+		if (comment != std::string::npos) line.erase(comment);
+		line = trimmed(line);
+		if (line.empty()) continue;
+		if (line.front() == '[') {
+			if (line.back() != ']') {
+				error = "line " + std::to_string(lineNumber) + ": unterminated section";
+				return false;
+			}
+			scenarios.push_back(Scenario{ trimmed(line.substr(1, line.size() - 2)), {} });
+			continue;
+		}
+		size_t equals = line.find('=');
+		if (equals == std::string::npos || scenarios.empty()) {
+			error = "line " + std::to_string(lineNumber) + ": expected key = value inside a section";
+			return false;
+		}
+		scenarios.back().settings[lowered(trimmed(line.substr(0, equals)))] = trimmed(line.substr(equals + 1));
+	}
+	return true;
+}
+
+inline bool parseNumber(const std::string& text, int& value) {
+	std::stringstream stream(text);
+	stream >> value;
+	return !stream.fail() && stream.eof();
+}
+
+inline bool parseNumber(const std::string& text, double& value) {
+	std::stringstream stream(text);
+	stream.imbue(std::locale::classic());
+	stream >> value;
+	return !stream.fail() && stream.eof();
+}
+
+// setting of scenario or fallback when missing or malformed, validated by configureScenario
+inline double scenarioReal(const Scenario& scenario, const std::string& key, double fallback) {
+	auto setting = scenario.settings.find(key);
+	double value = fallback;
+	if (setting == scenario.settings.end() || !parseNumber(setting->second, value)) return fallback;
+	return value;
+}
+
+// live status lines and depth series go to statsOut when scenario has report or depth key
+inline bool configureScenario(ProducerConsumerTesterBuilder& builder, const Scenario& scenario, std::string& error,
+	std::ostream* statsOut = nullptr) {
+	int capacity = 1024;
+	QueueKind queueKind = QueueKind::QUEUE;
+	int deadline = 1000;
+	int deadlineSpread = 0;
+	bool deadlineSet = false;
+	int delay = 1000;
+	int resolution = 1000;
+	bool delaySet = false;
+	RingMemory::Options ringOptions;
+	bool ringOptionsSet = false;
+	bool sequenced = false;
+	std::string metricsPath;
+	int metricsInterval = 5000;
+	int depthInterval = 0;
+	int depthSamples = 10000;
+	bool precisePacing = false;
+	std::string sourcePath;
+	int sourceBatch = 64;
+	SchedulingPolicy policies[2] = { SchedulingPolicy::NORMAL, SchedulingPolicy::NORMAL };
+	int priorities[2] = { 1, 1 };
+	int pacingSpin = 50;
+	bool sizeLimited = false;
+	bool decorated = false;
+	int maxSize = 0;
+	bool twoLockStrategy = false;
+	bool autoscaling = false;
+	bool consumersSet = false;
+	bool autoscaleSet = false; // keys of autoscale
+	AutoscalingConsumerPool::Settings autoscaleSettings;
+	auto mode = scenario.settings.find("mode");
+	const bool simulate = mode != scenario.settings.end() && lowered(mode->second) == "simulate";
+	// keys simulation models, it would silently ignore others
+	static const char* const simulatedKeys[] = { "mode", "queue", "capacity", "decorators", "maxsize", "strategy",
+		"producers", "consumers", "arrival", "producersleeptime", "pacing", "consumersleeptime", "batch", "duration" };
+	for (const auto& setting : scenario.settings) {
+		const std::string& key = setting.first;
+		const std::string value = lowered(setting.second);
+		int number = 0;
+		bool isNumber = parseNumber(value, number);
+		bool valid = true;
+		bool simulationKey = key == "seed" || key == "wakelatency" || key == "sleepovershoot";
+		if (simulationKey && !simulate) {
+			error = "'" + key + "' is for mode = simulate";
+			return false;
+		}
+		if (simulate && !simulationKey
+			&& std::find(std::begin(simulatedKeys), std::end(simulatedKeys), key) == std::end(simulatedKeys)) {
+			error = "'" + key + "' can't be simulated";
+			return false;
+		}
+		if (key == "mode") {
+			// read by runScenarios
+			valid = value == "test" || value == "simulate";
+		}
+		else if (key == "model") {
+			valid = value == "true" || value == "false";
+		}
+		else if (key == "targetfull" || key == "targetpercentile") {
+			double real = 0;
+			valid = parseNumber(value, real) && real > 0 && real < 1;
+		}
+		else if (key == "targetlatency") {
+			double real = 0;
+			valid = parseNumber(value, real) && real >= 0;
+		}
+		else if (key == "queue") {
+			if (value == "queue") queueKind = QueueKind::QUEUE;
+			else if (value == "ring") queueKind = QueueKind::RING;
+			else if (value == "twolock") queueKind = QueueKind::TWO_LOCK;
+			else if (value == "deadline" && !simulate) queueKind = QueueKind::DEADLINE;
+			else if (value == "delay" && !simulate) queueKind = QueueKind::DELAY;
+			else if (value == "deadline" || value == "delay") {
+				error = value + " queue can't be simulated";
+				return false;
+			}
+			else valid = false;
+		}
+		else if (key == "deadline" || key == "deadlinespread") {
+			valid = isNumber && (key == "deadline" ? number > 0 : number >= 0);
+			(key == "deadline" ? deadline : deadlineSpread) = number;
+			deadlineSet = true;
+		}
+		else if (key == "delay" || key == "resolution") {
+			valid = isNumber && (key == "delay" ? number >= 0 : number > 0);
+			(key == "delay" ? delay : resolution) = number;
+			delaySet = true;
+		}
+		else if (key == "hugepages" || key == "lockmemory") {
+			valid = value == "true" || value == "false";
+			(key == "hugepages" ? ringOptions.hugePages : ringOptions.lock) = value == "true";
+			ringOptionsSet = true;
+		}
+		else if (key == "capacity") {
+			valid = isNumber && number > 0;
+			capacity = number;
+		}
+		else if (key == "decorators") {
+			for (const std::string& decorator : splitList(value)) {
+				if (decorator == "sequenced" && simulate) {
+					error = "sequenced can't be simulated";
+					return false;
+				}
+				if (decorator == "sequenced") {
+					builder.setSequenced(true);
+					sequenced = true;
+				}
+				else if (decorator == "sizelimited") sizeLimited = true;
+				else valid = false;
+				decorated = true;
+			}
+		}
+		else if (key == "maxsize") {
+			valid = isNumber && number >= 0;
+			maxSize = number;
+			if (valid) builder.setMaxSize(number);
+		}
+		else if (key == "strategy") {
+			twoLockStrategy = value == "twolock";
+			if (value == "sleep") builder.setStrategy(StrategyKind::SLEEP);
+			else if (value == "wait") builder.setStrategy(StrategyKind::WAIT);
+			else if (value == "bruteforce") builder.setStrategy(StrategyKind::BRUTE_FORCE);
+			else if (value == "adaptive") builder.setStrategy(StrategyKind::ADAPTIVE);
+			else if (value == "twolock") builder.setStrategy(StrategyKind::TWO_LOCK);
+			else if (value == "pause") builder.setStrategy(StrategyKind::PAUSE);
+			else if (value == "yield") builder.setStrategy(StrategyKind::YIELD);
+			else if (value == "exponential") builder.setStrategy(StrategyKind::EXPONENTIAL);
+			else if (value == "jittered") builder.setStrategy(StrategyKind::JITTERED);
+			else valid = false;
+		}
+		else if (key == "producers") {
+			valid = isNumber && number > 0;
+			if (valid) builder.setProducersCount(number);
+		}
+		else if (key == "consumers") {
+			valid = isNumber && number > 0;
+			if (valid) builder.setConsumersCount(number);
+			consumersSet = true;
+		}
+		else if (key == "autoscale") {
+			valid = value == "true" || value == "false";
+			autoscaling = value == "true";
+		}
+		else if (key == "minconsumers" || key == "maxconsumers") {
+			valid = isNumber && number > 0;
+			(key == "minconsumers" ? autoscaleSettings.minConsumers : autoscaleSettings.maxConsumers) = number;
+			autoscaleSet = true;
+		}
+		else if (key == "scaleinterval") {
+			valid = isNumber && number > 0;
+			autoscaleSettings.interval = std::chrono::milliseconds(number);
+			autoscaleSet = true;
+		}
+		else if (key == "arrival") {
+			if (value == "uniform") builder.setArrivalProcess(ArrivalProcess::UNIFORM);
+			else if (value == "poisson") builder.setArrivalProcess(ArrivalProcess::POISSON);
+			else if (value == "constant") builder.setArrivalProcess(ArrivalProcess::CONSTANT);
+			else valid = false;
+		}
+		else if (key == "producersleeptime") {
+			valid = isNumber && number > 0;
+			if (valid) builder.setProducerSleepTime(number);
+		}
+		else if (key == "pacing") {
+			valid = value == "sleep" || value == "precise";
+			precisePacing = value == "precise";
+			if (precisePacing && simulate) {
+				error = "precise pacing can't be simulated";
+				return false;
+			}
+		}
+		else if (key == "pacingspin") {
+			valid = isNumber && number >= 0;
+			pacingSpin = number;
+		}
+		else if (key == "consumersleeptime") {
+			valid = isNumber && number > 0;
+			if (valid) builder.setConsumerSleepTime(number);
+		}
+		else if (key == "batch") {
+			valid = isNumber && number > 0;
+			if (valid) builder.setConsumeBatchSize(number);
+		}
+		else if (key == "duration") {
+			valid = isNumber && number > 0;
+			if (valid) builder.setDuration(std::chrono::milliseconds(number));
+		}
+		else if (key == "pin") {
+			std::vector<int> cpus;
+			for (const std::string& cpu : splitList(value)) {
+				if (!parseNumber(cpu, number)) valid = false;
+				cpus.push_back(number);
+			}
+			if (valid) builder.setPinning(cpus);
+		}
+		else if (key == "source") {
+			sourcePath = setting.second;
+			valid = !sourcePath.empty();
+		}
+		else if (key == "sourcebatch") {
+			valid = isNumber && number > 0;
+			sourceBatch = number;
+		}
+		else if (key == "recordtrace") {
+			valid = !setting.second.empty();
+			builder.setTraceRecording(setting.second);
+		}
+		else if (key == "replaytrace") {
+			valid = !setting.second.empty();
+			builder.setTraceReplay(setting.second);
+		}
+		else if (key == "sink") {
+			// path keeps its case
+			valid = !setting.second.empty();
+			builder.setSinkFile(setting.second);
+		}
+		else if (key == "metrics") {
+			// path keeps its case
+			metricsPath = setting.second;
+			valid = !metricsPath.empty();
+		}
+		else if (key == "metricsinterval") {
+			valid = isNumber && number > 0;
+			metricsInterval = number;
+		}
+		else if (key == "depth") {
+			valid = isNumber && number > 0;
+			depthInterval = number;
+		}
+		else if (key == "depthsamples") {
+			valid = isNumber && number > 0;
+			depthSamples = number;
+		}
+		else if (key == "producerspolicy" || key == "consumerspolicy") {
+			SchedulingPolicy& policy = policies[key == "producerspolicy" ? 0 : 1];
+			if (value == "normal") policy = SchedulingPolicy::NORMAL;
+			else if (value == "fifo") policy = SchedulingPolicy::FIFO;
+			else if (value == "rr") policy = SchedulingPolicy::ROUND_ROBIN;
+			else valid = false;
+		}
+		else if (key == "producerspriority" || key == "consumerspriority") {
+			valid = isNumber;
+			priorities[key == "producerspriority" ? 0 : 1] = number;
+		}
+		else if (key == "seed") {
+			valid = isNumber && number >= 0;
+			if (valid) builder.setSimulationSeed(static_cast<unsigned>(number));
+		}
+		else if (key == "wakelatency" || key == "sleepovershoot") {
+			double microseconds = 0;
+			if (key == "sleepovershoot" && value == "auto") microseconds = -1;
+			else valid = parseNumber(value, microseconds) && microseconds >= 0;
+			std::chrono::nanoseconds time(static_cast<long long>(microseconds * 1000));
+			if (valid && key == "wakelatency") builder.setWakeLatency(time);
+			else if (valid) builder.setSleepOvershoot(time);
+		}
+		else if (key == "report") {
+			valid = isNumber && number > 0;
+			if (valid) builder.setStatsReport(statsOut, std::chrono::milliseconds(number));
+		}
+		else {
+			error = "unknown key '" + key + "'";
+			return false;
+		}
+		if (!valid) {
+			error = "bad value '" + setting.second + "' for '" + key + "'";
+			return false;
+		}
+	}
+	// builder would drop decorators of twolock strategy and take maxSize without sizelimited
+	if (twoLockStrategy && decorated) {
+		error = "decorators can't be used with strategy twolock, maxSize limits its queue";
+		return false;
+	}
+	if (!twoLockStrategy && sizeLimited != (maxSize > 0)) {
+		error = "sizelimited and maxSize go together";
+		return false;
+	}
+	if (queueKind != QueueKind::DEADLINE && deadlineSet) {
+		error = "deadline and deadlineSpread are for queue deadline";
+		return false;
+	}
+	if (queueKind != QueueKind::RING && ringOptionsSet) {
+		error = "hugePages and lockMemory are for queue ring";
+		return false;
+	}
+	if (queueKind != QueueKind::DELAY && delaySet) {
+		error = "delay and resolution are for queue delay";
+		return false;
+	}
+	if ((queueKind == QueueKind::DEADLINE || queueKind == QueueKind::DELAY) && sequenced) {
+		error = "sequenced can't be used with queue deadline or delay, they don't keep produced order";
+		return false;
+	}
+	if (!autoscaling && autoscaleSet) {
+		error = "minConsumers, maxConsumers and scaleInterval are for autoscale";
+		return false;
+	}
+	if (autoscaling && consumersSet) {
+		error = "consumers can't be used with autoscale, minConsumers and maxConsumers bound them";
+		return false;
+	}
+	if (autoscaling && autoscaleSettings.minConsumers > autoscaleSettings.maxConsumers) {
+		error = "minConsumers is above maxConsumers";
+		return false;
+	}
+	if (autoscaling && policies[1] != SchedulingPolicy::NORMAL) {
+		error = "consumersPolicy can't be used with autoscale, pool threads are not scheduled";
+		return false;
+	}
+	builder.setAutoscaling(autoscaling, autoscaleSettings);
+	builder.setQueue(queueKind, capacity, ringOptions);
+	error = builder.conflict();
+	if (!error.empty()) return false;
+	builder.setDeadline(std::chrono::microseconds(deadline), std::chrono::microseconds(deadlineSpread));
+	builder.setDelay(std::chrono::microseconds(delay), std::chrono::microseconds(resolution));
+	if (!metricsPath.empty()) {
+		builder.setMetricsFile(metricsPath, prometheusLabel("scenario", scenario.name),
+			std::chrono::milliseconds(metricsInterval));
+	}
+	if (!sourcePath.empty()) builder.setSourceFile(sourcePath, sourceBatch);
+	builder.setPrecisePacing(precisePacing, std::chrono::microseconds(pacingSpin));
+	builder.setProducersScheduling(policies[0], priorities[0]);
+	builder.setConsumersScheduling(policies[1], priorities[1]);
+	if (depthInterval > 0) builder.setDepthSampling(statsOut, std::chrono::microseconds(depthInterval), depthSamples);
+	return true;
+}
+
+// predictions from measured rates next to measured values, then smallest consumers count
+// and queue limit meeting targets
+inline void writeModel(const Scenario& scenario, const TestReport& report, std::ostream& out) {
+	double percentile = scenarioReal(scenario, "targetpercentile", 0.99);
+	QueueModel queueModel;
+	queueModel.arrivalRate = report.arrivalRate();
+	queueModel.serviceRate = report.serviceRate();
+	queueModel.serviceCv2 = report.serviceCv2;
+	queueModel.consumers = report.consumers;
+	// consumers take batches, service is measured per batch
+	queueModel.batchSize = report.batchSize;
+	QueueModel::Prediction prediction = queueModel.predict(report.queueLimit, percentile);
+	// nearest measured percentile
+	double measured = percentile >= 0.999 ? report.latencyP999 : percentile >= 0.99 ? report.latencyP99 : report.latencyP50;
+	out << scenario.name
+		<< ": model arrivalRate=" << queueModel.arrivalRate
+		<< " serviceRate=" << queueModel.serviceRate
+		<< " serviceCv2=" << queueModel.serviceCv2
+		<< " batchSize=" << queueModel.batchSize
+		<< " utilisation=" << prediction.utilisation
+		<< " stable=" << prediction.stable
+		<< " predictedLatency=" << prediction.latency * 1e6 << "us"
+		<< " measuredLatency=" << measured << "us"
+		<< " predictedFull=" << prediction.fullProbability
+		<< " measuredFull=" << report.fullShare();
+	QueueModel::Recommendation recommendation = queueModel.recommend(scenarioReal(scenario, "targetfull", 0.001),
+		percentile, scenarioReal(scenario, "targetlatency", 0) / 1e6);
+	if (recommendation.found) {
+		out << " recommendedConsumers=" << recommendation.consumers
+			<< " recommendedMaxSize=" << recommendation.queueLimit;
+	}
+	else out << " recommendation=none";
+	out << std::endl;
+}
+
+// runs scenarios one after another, one result line per scenario
+inline void runScenarios(const std::vector<Scenario>& scenarios, std::ostream& out) {
+	for (const Scenario& scenario : scenarios) {
+		ProducerConsumerTesterBuilder builder;
+		std::string error;
+		if (!configureScenario(builder, scenario, error, &out)) {
+			out << scenario.name << ": error: " << error << std::endl;
+			continue;
+		}
+		auto mode = scenario.settings.find("mode");
+		if (mode != scenario.settings.end() && lowered(mode->second) == "simulate") {
+			// configureScenario took only keys the simulation models
+			SimulationReport simulated = builder.buildSimulation().run();
+			out << scenario.name
+				<< ": simulated produced=" << simulated.produced
+				<< " consumed=" << simulated.consumed
+				<< " seconds=" << simulated.seconds
+				<< " throughput=" << simulated.throughput()
+				<< " rejects=" << simulated.rejects
+				<< " fullProduced=" << simulated.fullProduced
+				<< " maxDepth=" << simulated.maxDepth
+				<< " meanDepth=" << simulated.meanDepth
+				<< " p50=" << simulated.latencyP50 << "us"
+				<< " p99=" << simulated.latencyP99 << "us"
+				<< " p999=" << simulated.latencyP999 << "us"
+				<< " events=" << simulated.events
+				<< std::endl;
+			continue;
+		}
+		ProducerConsumerTester tester = builder.build();
+		TestReport report = tester.test();
+		out << scenario.name
+			<< ": produced=" << report.produced
+			<< " consumed=" << report.consumed
+			<< " seconds=" << report.seconds
+			<< " throughput=" << report.throughput()
+			<< " requestedRate=";
+		// pace of file or trace is not requested
+		if (report.requestedRate >= 0) out << report.requestedRate;
+		else out << "n/a";
+		out << " producedRate=" << report.producedRate()
+			<< " violations=" << report.violations
+			<< " reordered=" << report.reordered
+			<< " reorderWindow=" << report.reorderWindow
+			<< " missedDeadlines=" << (report.missedDeadlines >= 0 ? std::to_string(report.missedDeadlines) : "n/a")
+			<< " earlyReleases=" << report.earlyReleases
+			<< " hugePages=" << report.hugePages
+			<< " memoryLocked=" << report.memoryLocked
+			<< " pinFailures=" << report.pinFailures
+			<< " producersPolicy=" << policyName(report.producersPolicy)
+			<< " consumersPolicy=" << policyName(report.consumersPolicy)
+			<< " schedulingFailures=" << report.schedulingFailures
+			<< " sinkBytes=" << report.sinkBytes
+			<< " sinkStalls=" << report.sinkStalls
+			<< " sinkFailures=" << report.sinkFailures
+			<< " sourceFailed=" << report.sourceFailed
+			<< " traceFailed=" << report.traceFailed
+			<< " waits=" << report.waits
+			<< " consumers=" << report.consumers
+			<< " scaleUps=" << report.scaleUps
+			<< " scaleDowns=" << report.scaleDowns
+			<< " p50=" << report.latencyP50 << "us"
+			<< " p99=" << report.latencyP99 << "us"
+			<< " p999=" << report.latencyP999 << "us"
+			<< " cpuNsPerItem=" << report.cpuNsPerItem()
+			<< " producersCpuMs=" << report.producersCpu.cpuNs / 1e6
+			<< " consumersCpuMs=" << report.consumersCpu.cpuNs / 1e6
+			<< " voluntarySwitches=" << report.producersCpu.voluntarySwitches + report.consumersCpu.voluntarySwitches
+			<< " involuntarySwitches=" << report.producersCpu.involuntarySwitches + report.consumersCpu.involuntarySwitches
+			<< std::endl;
+		auto model = scenario.settings.find("model");
+		if (model != scenario.settings.end() && lowered(model->second) == "true") writeModel(scenario, report, out);
+	}
+}
@@ -0,0 +1,492 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <ostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <locale>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+#include <initializer_list>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+// counter written by one thread only, so no locked instruction on data path,
+// padded to keep writers of different counters off each other's cache line
+struct alignas(64) ThreadCounter {
+	std::atomic<long long> value{ 0 };
+	void add(long long delta) { value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed); }
+	long long load() const { return value.load(std::memory_order_relaxed); }
+};
+
+// cpu used by calling thread so far
+struct ThreadCpu {
+	long long cpuNs = 0; // user and kernel
+	long long voluntarySwitches = 0; // thread blocked
+	long long involuntarySwitches = 0; // thread preempted
+
+	// false if not available, Windows has no per-thread context switch counts, they stay 0
+	static bool current(ThreadCpu& cpu) {
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return false;
+		auto ticks = [](const FILETIME& time) {
+			return static_cast<long long>((static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime);
+		};
+		cpu.cpuNs = (ticks(kernel) + ticks(user)) * 100;
+		return true;
+#else
+		timespec time;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) return false;
+		cpu.cpuNs = static_cast<long long>(time.tv_sec) * 1000000000 + time.tv_nsec;
+#ifdef RUSAGE_THREAD
+		rusage usage;
+		if (getrusage(RUSAGE_THREAD, &usage) != 0) return false;
+		cpu.voluntarySwitches = usage.ru_nvcsw;
+		cpu.involuntarySwitches = usage.ru_nivcsw;
+#endif
+		return true;
+#endif
+	}
+	ThreadCpu& operator+=(const ThreadCpu& other) {
+		cpuNs += other.cpuNs;
+		voluntarySwitches += other.voluntarySwitches;
+		involuntarySwitches += other.involuntarySwitches;
+		return *this;
+	}
+	ThreadCpu operator-(const ThreadCpu& other) const {
+		ThreadCpu difference(*this);
+		difference.cpuNs -= other.cpuNs;
+		difference.voluntarySwitches -= other.voluntarySwitches;
+		difference.involuntarySwitches -= other.involuntarySwitches;
+		return difference;
+	}
+};
+
+// log-linear histogram of nanoseconds: 8 sub-buckets per power of two (~12% precision),
+// single writer like ThreadCounter, readers sum snapshots of several histograms
+class LatencyHistogram {
+public:
+	static const int SUB_BUCKETS = 8;
+	static const int BUCKETS = 64 * SUB_BUCKETS;
+	typedef std::vector<long long> Snapshot;
+private:
+	std::atomic<long long> buckets[BUCKETS];
+	std::atomic<long long> total{ 0 }; // of recorded ns
+public:
+	LatencyHistogram() {
+		for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+	}
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+	static int bucketOf(long long ns) {
+		if (ns < SUB_BUCKETS) return ns < 0 ? 0 : static_cast<int>(ns);
+		int exponent = 63;
+		while (!(ns >> exponent)) --exponent;
+		// top bit gives exponent, next 3 bits give sub-bucket
+		int sub = static_cast<int>((ns >> (exponent - 3)) & (SUB_BUCKETS - 1));
+		return (exponent - 2) * SUB_BUCKETS + sub;
+	}
+	// largest value falling into bucket
+	static long long upperBound(int bucket) {
+		if (bucket < SUB_BUCKETS) return bucket;
+		int exponent = bucket / SUB_BUCKETS + 2;
+		long long sub = bucket % SUB_BUCKETS;
+		return ((SUB_BUCKETS + sub + 1) << (exponent - 3)) - 1;
+	}
+	void record(long long ns) {
+		std::atomic<long long>& bucket = buckets[bucketOf(ns)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+	}
+	long long sum() const { return total.load(std::memory_order_relaxed); }
+	void addTo(Snapshot& snapshot) const {
+		snapshot.resize(BUCKETS, 0);
+		for (int i = 0; i < BUCKETS; ++i) snapshot[i] += buckets[i].load(std::memory_order_relaxed);
+	}
+	static long long count(const Snapshot& snapshot) {
+		long long total = 0;
+		for (long long bucketCount : snapshot) total += bucketCount;
+		return total;
+	}
+	// quantile in [0, 1], bucket upper bound in ns, 0 for empty snapshot
+	static long long percentile(const Snapshot& snapshot, double quantile) {
+		long long total = count(snapshot);
+		if (total == 0) return 0;
+		long long rank = static_cast<long long>(quantile * (total - 1)) + 1;
+		long long seen = 0;
+		for (size_t i = 0; i < snapshot.size(); ++i) {
+			seen += snapshot[i];
+			if (seen >= rank) return upperBound(static_cast<int>(i));
+		}
+		return upperBound(BUCKETS - 1);
+	}
+	static Snapshot difference(const Snapshot& later, const Snapshot& earlier) {
+		Snapshot result(later);
+		for (size_t i = 0; i < result.size() && i < earlier.size(); ++i) result[i] -= earlier[i];
+		return result;
+	}
+};
+
+// readers of running test, sources are only read, data path is not touched;
+// empty functions read as zero
+struct StatsSources {
+	std::function<long long()> produced;
+	std::function<long long()> consumed;
+	std::function<int()> depth;
+	std::function<long long()> waits;
+	std::function<long long()> rejects;
+	// adds histogram to snapshot, returns sum of recorded ns
+	std::function<long long(LatencyHistogram::Snapshot&)> latencies;
+	// consumer threads running now; autoscaling pool decisions that added or retired one,
+	// left empty without pool, so fixed consumers don't show decisions
+	std::function<int()> consumers;
+	std::function<long long()> scaleUps;
+	std::function<long long()> scaleDowns;
+};
+
+// runs task every interval from its own thread until stopped
+class PeriodicTask {
+	std::thread runner;
+	std::mutex stopLock;
+	std::condition_variable onStop;
+	bool stop = false;
+public:
+	PeriodicTask() = default;
+	PeriodicTask(const PeriodicTask&) = delete;
+	PeriodicTask& operator=(const PeriodicTask&) = delete;
+	void start(std::chrono::microseconds interval, std::function<void()> task) {
+		runner = std::thread([this, interval, task]() {
+			std::unique_lock<std::mutex> locker(stopLock);
+			while (!onStop.wait_for(locker, interval, [this]() { return stop; })) {
+				locker.unlock();
+				task();
+				locker.lock();
+			}
+		});
+	}
+	void setStop(bool stop) {
+		if (!stop) return;
+		{
+			std::unique_lock<std::mutex> locker(stopLock);
+			this->stop = true;
+		}
+		onStop.notify_all();
+		if (runner.joinable()) runner.join();
+	}
+	~PeriodicTask() { setStop(true); }
+};
+
+// prints status line every interval:
+// throughput and latency over a sliding window of last windowIntervals intervals
+class StatsReporter {
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef StatsSources Sources;
+private:
+	struct Sample {
+		Clock::time_point time;
+		long long consumed;
+		long long waits;
+		LatencyHistogram::Snapshot latencies;
+	};
+	Sources sources;
+	std::ostream& out;
+	std::chrono::milliseconds interval;
+	size_t windowIntervals;
+	std::deque<Sample> window;
+	Clock::time_point startTime;
+	PeriodicTask reporter;
+
+	Sample sample() const {
+		Sample current{ Clock::now(), sources.consumed ? sources.consumed() : 0, sources.waits ? sources.waits() : 0, {} };
+		if (sources.latencies) sources.latencies(current.latencies);
+		return current;
+	}
+	void report() {
+		Sample current = sample();
+		const Sample& oldest = window.front();
+		double seconds = std::chrono::duration<double>(current.time - oldest.time).count();
+		LatencyHistogram::Snapshot latencies = LatencyHistogram::difference(current.latencies, oldest.latencies);
+		// formatted aside, flags of out stay untouched
+		std::ostringstream line;
+		line << std::fixed << std::setprecision(3)
+			<< "t=" << std::chrono::duration<double>(current.time - startTime).count() << "s"
+			<< std::setprecision(0)
+			<< " produced=" << (sources.produced ? sources.produced() : 0)
+			<< " consumed=" << current.consumed
+			<< " throughput=" << (seconds > 0 ? (current.consumed - oldest.consumed) / seconds : 0) << "/s"
+			<< " depth=" << (sources.depth ? sources.depth() : 0)
+			<< std::setprecision(1)
+			<< " p50=" << LatencyHistogram::percentile(latencies, 0.5) / 1000.0 << "us"
+			<< " p99=" << LatencyHistogram::percentile(latencies, 0.99) / 1000.0 << "us"
+			<< " p999=" << LatencyHistogram::percentile(latencies, 0.999) / 1000.0 << "us"
+			<< " waits=" << current.waits - oldest.waits;
+		if (sources.consumers) line << " consumers=" << sources.consumers();
+		if (sources.scaleUps || sources.scaleDowns) {
+			line << " scaled=+" << (sources.scaleUps ? sources.scaleUps() : 0)
+				<< "/-" << (sources.scaleDowns ? sources.scaleDowns() : 0);
+		}
+		line << '\n';
+		out << line.str() << std::flush;
+		window.push_back(std::move(current));
+		if (window.size() > windowIntervals) window.pop_front();
+	}
+public:
+	StatsReporter(Sources sources, std::ostream& out, std::chrono::milliseconds interval, int windowIntervals = 5)
+		: sources(sources), out(out), interval(interval), windowIntervals(windowIntervals > 0 ? windowIntervals : 1) {}
+	StatsReporter(const StatsReporter&) = delete;
+	StatsReporter& operator=(const StatsReporter&) = delete;
+	void start() {
+		startTime = Clock::now();
+		window.push_back(sample());
+		reporter.start(interval, [this]() { report(); });
+	}
+	void setStop(bool stop) { reporter.setStop(stop); }
+};
+
+// value of Prometheus label, quotes, backslashes and newlines escaped
+inline std::string prometheusLabel(const std::string& name, const std::string& value) {
+	std::string escaped;
+	for (char c : value) {
+		if (c == '\\' || c == '"') escaped += '\\';
+		if (c == '\n') escaped += "\\n";
+		else escaped += c;
+	}
+	return name + "=\"" + escaped + "\"";
+}
+
+// metrics in Prometheus text exposition format, rewritten every interval
+// to a file for textfile collector, replaced at once so scraper never sees half a file
+class PrometheusExporter {
+public:
+	typedef std::chrono::steady_clock Clock;
+private:
+	StatsSources sources;
+	std::string path;
+	std::string labels; // e.g. scenario="name", may be empty
+	std::chrono::milliseconds interval;
+	PeriodicTask exporter;
+	Clock::time_point lastTime;
+	long long lastConsumed = 0;
+	double lastThroughput = 0;
+	bool measured = false; // lastThroughput is over an interval
+	bool stopped = false;
+
+	std::string labelled(const std::string& extra = std::string()) const {
+		if (labels.empty() && extra.empty()) return std::string();
+		return "{" + labels + (labels.empty() || extra.empty() ? "" : ",") + extra + "}";
+	}
+	static void header(std::ostream& out, const char* name, const char* type, const char* help) {
+		out << "# HELP " << name << " " << help << "\n"
+			<< "# TYPE " << name << " " << type << "\n";
+	}
+	// integer, every digit kept however large
+	void counter(std::ostream& out, const char* name, const char* help, long long value) const {
+		header(out, name, "counter", help);
+		out << name << labelled() << " " << value << "\n";
+	}
+	// one counter, a sample per value of label
+	void counter(std::ostream& out, const char* name, const char* help, const char* label,
+		std::initializer_list<std::pair<const char*, long long>> values) const {
+		header(out, name, "counter", help);
+		for (const auto& value : values) {
+			out << name << labelled(prometheusLabel(label, value.first)) << " " << value.second << "\n";
+		}
+	}
+	// precision of out decides digits
+	void gauge(std::ostream& out, const char* name, const char* help, double value) const {
+		header(out, name, "gauge", help);
+		out << name << labelled() << " " << value << "\n";
+	}
+	static bool replace(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+		return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+	}
+public:
+	PrometheusExporter(StatsSources sources, const std::string& path, const std::string& labels,
+		std::chrono::milliseconds interval)
+		: sources(sources), path(path), labels(labels), interval(interval) {}
+	PrometheusExporter(const PrometheusExporter&) = delete;
+	PrometheusExporter& operator=(const PrometheusExporter&) = delete;
+	// throughput is over time since previous write; after stop consumers are gone,
+	// so final write keeps the last measured throughput instead of a near empty interval
+	void write(std::ostream& out) {
+		Clock::time_point now = Clock::now();
+		long long consumed = sources.consumed ? sources.consumed() : 0;
+		double seconds = std::chrono::duration<double>(now - lastTime).count();
+		if (!stopped || !measured) {
+			lastThroughput = seconds > 0 ? (consumed - lastConsumed) / seconds : 0;
+			measured = seconds > 0;
+		}
+		lastTime = now;
+		lastConsumed = consumed;
+
+		std::ostringstream text;
+		text.imbue(std::locale::classic());
+		text << std::setprecision(std::numeric_limits<double>::max_digits10);
+		counter(text, "producer_consumer_produced_total", "Items produced.", sources.produced ? sources.produced() : 0);
+		counter(text, "producer_consumer_consumed_total", "Items consumed.", consumed);
+		counter(text, "producer_consumer_rejects_total", "Produce attempts that found the queue full.",
+			sources.rejects ? sources.rejects() : 0);
+		counter(text, "producer_consumer_waits_total", "Failed attempts, sleeps and blocking waits of strategy.",
+			sources.waits ? sources.waits() : 0);
+		gauge(text, "producer_consumer_depth", "Approximate number of queued items.", sources.depth ? sources.depth() : 0);
+		gauge(text, "producer_consumer_throughput", "Items consumed per second since previous export.", lastThroughput);
+		if (sources.consumers) {
+			gauge(text, "producer_consumer_consumers", "Consumer threads running.", sources.consumers());
+		}
+		if (sources.scaleUps || sources.scaleDowns) {
+			counter(text, "producer_consumer_scaling_decisions_total",
+				"Autoscaling decisions that added (up) or retired (down) a consumer.", "direction",
+				{ { "up", sources.scaleUps ? sources.scaleUps() : 0 },
+				{ "down", sources.scaleDowns ? sources.scaleDowns() : 0 } });
+		}
+
+		LatencyHistogram::Snapshot snapshot;
+		long long sum = sources.latencies ? sources.latencies(snapshot) : 0;
+		snapshot.resize(LatencyHistogram::BUCKETS, 0);
+		const char* name = "producer_consumer_wait_seconds";
+		header(text, name, "histogram", "Time items wait in queue from produce to consume.");
+		// histogram buckets counted whole into first bound above their upper bound
+		static const double bounds[] = { 1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4,
+			1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+		long long cumulative = 0;
+		int bucket = 0;
+		for (double bound : bounds) {
+			while (bucket < LatencyHistogram::BUCKETS && LatencyHistogram::upperBound(bucket) <= bound * 1e9) {
+				cumulative += snapshot[bucket++];
+			}
+			std::ostringstream le;
+			le.imbue(std::locale::classic());
+			le << bound;
+			text << name << "_bucket" << labelled("le=\"" + le.str() + "\"") << " " << cumulative << "\n";
+		}
+		long long count = LatencyHistogram::count(snapshot);
+		text << name << "_bucket" << labelled("le=\"+Inf\"") << " " << count << "\n"
+			<< name << "_sum" << labelled() << " " << sum / 1e9 << "\n"
+			<< name << "_count" << labelled() << " " << count << "\n";
+		out << text.str();
+	}
+	// false if file could not be written
+	bool writeFile() {
+		std::string temporary = path + ".tmp";
+		{
+			std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+			if (!file) return false;
+			write(file);
+			if (!file.flush()) return false;
+		}
+		return replace(temporary, path);
+	}
+	void start() {
+		lastTime = Clock::now();
+		lastConsumed = sources.consumed ? sources.consumed() : 0;
+		writeFile();
+		// first file has no interval behind it
+		measured = false;
+		exporter.start(interval, [this]() { writeFile(); });
+	}
+	// final values are written once more on stop
+	void setStop(bool stop) {
+		if (!stop) return;
+		exporter.setStop(true);
+		stopped = true;
+		writeFile();
+	}
+};
+
+// samples depth every interval into ring preallocated before start, keeps last capacity samples;
+// full and empty follow from lock-free depth and limit, queue itself is not locked
+class DepthSampler {
+public:
+	typedef std::chrono::steady_clock Clock;
+	struct Sample {
+		long long time; // microseconds since start
+		int depth;
+		bool full;
+		bool empty;
+		long long rejects; // since previous sample
+	};
+private:
+	StatsSources sources;
+	int limit; // 0 is unlimited, never full
+	std::chrono::microseconds interval;
+	std::vector<Sample> ring;
+	size_t taken = 0; // all samples, ring holds the last ones
+	Clock::time_point startTime;
+	long long lastRejects = 0;
+	PeriodicTask sampler;
+
+	void sample() {
+		int depth = sources.depth ? sources.depth() : 0;
+		long long rejects = sources.rejects ? sources.rejects() : 0;
+		ring[taken % ring.size()] = Sample{
+			std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startTime).count(),
+			depth, limit > 0 && depth >= limit, depth == 0, rejects - lastRejects
+		};
+		lastRejects = rejects;
+		++taken;
+	}
+public:
+	DepthSampler(StatsSources sources, int limit, std::chrono::microseconds interval, int capacity)
+		: sources(sources), limit(limit), interval(interval), ring(capacity > 0 ? capacity : 1) {}
+	DepthSampler(const DepthSampler&) = delete;
+	DepthSampler& operator=(const DepthSampler&) = delete;
+	void start() {
+		startTime = Clock::now();
+		lastRejects = sources.rejects ? sources.rejects() : 0;
+		sampler.start(interval, [this]() { sample(); });
+	}
+	void setStop(bool stop) { sampler.setStop(stop); }
+	// oldest first, only after stop
+	std::vector<Sample> samples() const {
+		std::vector<Sample> ordered;
+		size_t kept = (std::min)(taken, ring.size());
+		for (size_t i = taken - kept; i < taken; ++i) ordered.push_back(ring[i % ring.size()]);
+		return ordered;
+	}
+	// summary line, then one csv line per sample
+	void write(std::ostream& out) const {
+		std::vector<Sample> series = samples();
+		int maxDepth = 0;
+		size_t full = 0, empty = 0;
+		for (const Sample& current : series) {
+			maxDepth = (std::max)(maxDepth, current.depth);
+			if (current.full) ++full;
+			if (current.empty) ++empty;
+		}
+		std::ostringstream text;
+		text.imbue(std::locale::classic());
+		double percent = series.empty() ? 0 : 100.0 / series.size();
+		text << std::fixed << std::setprecision(1)
+			<< "depth: interval=" << interval.count() << "us samples=" << series.size()
+			<< " dropped=" << taken - series.size() << " limit=" << limit << " maxDepth=" << maxDepth
+			<< " full=" << full * percent << "% empty=" << empty * percent << "%\n"
+			<< "time_us,depth,full,empty,rejects\n";
+		for (const Sample& current : series) {
+			text << current.time << "," << current.depth << "," << current.full << ","
+				<< current.empty << "," << current.rejects << "\n";
+		}
+		out << text.str() << std::flush;
+	}
+};
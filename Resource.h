@@ -1,36 +1,36 @@
-//{{NO_DEPENDENCIES}}
-// Microsoft Visual C++ generated include file.
-// Used by ProducerConsumerProblem.rc
-//
-#define IDM_ABOUTBOX                    0x0010
-#define IDS_ABOUTBOX                    101
-#define IDD_PRODUCERCONSUMERPROBLEM_DIALOG 102
-#define IDR_MAINFRAME                   128
-#define IDC_COMBO1                      1000
-#define IDC_BUTTON1                     1001
-#define IDC_BUTTONSTART                 1001
-#define IDC_BUTTON2                     1002
-#define IDC_OUTPUT                      1003
-#define IDC_SLIDERPST                   1004
-#define IDC_SLIDER2                     1005
-#define IDC_SLIDER3                     1006
-#define IDC_EDIT2                       1007
-#define IDC_EDIT3                       1008
-#define IDC_EDIT4                       1009
-#define IDC_EDIT5                       1010
-#define IDC_EDIT6                       1011
-#define IDC_SLIDER4                     1012
-#define IDC_SLIDER5                     1013
-#define IDC_SLIDER6                     1014
-#define IDC_EDIT7                       1015
-
-// Next default values for new objects
-// 
-#ifdef APSTUDIO_INVOKED
-#ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        131
-#define _APS_NEXT_COMMAND_VALUE         32771
-#define _APS_NEXT_CONTROL_VALUE         1008
-#define _APS_NEXT_SYMED_VALUE           101
-#endif
-#endif
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by ProducerConsumerProblem.rc
+//
+#define IDM_ABOUTBOX                    0x0010
+#define IDS_ABOUTBOX                    101
+#define IDD_PRODUCERCONSUMERPROBLEM_DIALOG 102
+#define IDR_MAINFRAME                   128
+#define IDC_COMBO1                      1000
+#define IDC_BUTTON1                     1001
+#define IDC_BUTTONSTART                 1001
+#define IDC_BUTTON2                     1002
+#define IDC_OUTPUT                      1003
+#define IDC_SLIDERPST                   1004
+#define IDC_SLIDER2                     1005
+#define IDC_SLIDER3                     1006
+#define IDC_EDIT2                       1007
+#define IDC_EDIT3                       1008
+#define IDC_EDIT4                       1009
+#define IDC_EDIT5                       1010
+#define IDC_EDIT6                       1011
+#define IDC_SLIDER4                     1012
+#define IDC_SLIDER5                     1013
+#define IDC_SLIDER6                     1014
+#define IDC_EDIT7                       1015
+
+// Next default values for new objects
+// 
+#ifdef APSTUDIO_INVOKED
+#ifndef APSTUDIO_READONLY_SYMBOLS
+#define _APS_NEXT_RESOURCE_VALUE        131
+#define _APS_NEXT_COMMAND_VALUE         32771
+#define _APS_NEXT_CONTROL_VALUE         1008
+#define _APS_NEXT_SYMED_VALUE           101
+#endif
+#endif
@@ -1,8 +1,8 @@
-
-// stdafx.cpp : source file that includes just the standard includes
-// ProducerConsumerProblem.pch will be the pre-compiled header
-// stdafx.obj will contain the pre-compiled type information
-
-#include "stdafx.h"
-
-
+
+// stdafx.cpp : source file that includes just the standard includes
+// ProducerConsumerProblem.pch will be the pre-compiled header
+// stdafx.obj will contain the pre-compiled type information
+
+#include "stdafx.h"
+
+